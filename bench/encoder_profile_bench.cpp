@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//stdlib
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+//mumlib
+#include "mumlib2/constants.h"
+#include "mumlib2/structs.h"
+#include "mumlib2_private/audio_encoder.h"
+
+using namespace mumlib2;
+
+namespace {
+    constexpr uint32_t samplerate = MUMBLE_AUDIO_SAMPLERATE;
+    constexpr uint32_t block_ms = 10;
+    constexpr uint32_t seconds = 10;
+
+    //voiced harmonics with a syllable envelope and pauses, so DTX and VBR have something to react to
+    std::vector<int16_t> createClip()
+    {
+        constexpr float pi = 3.14159265f;
+
+        std::vector<int16_t> clip(samplerate * seconds);
+        uint32_t noise = 1;
+        for (size_t index = 0; index < clip.size(); index++) {
+            float time = static_cast<float>(index) / samplerate;
+            float pitch = 140.0f + 30.0f * std::sin(2.0f * pi * 0.7f * time);
+
+            float sample = 0.0f;
+            for (int harmonic = 1; harmonic <= 12; harmonic++) {
+                sample += std::sin(2.0f * pi * pitch * harmonic * time) / harmonic;
+            }
+
+            noise = noise * 1664525u + 1013904223u;
+            sample += (static_cast<float>(noise >> 16) / 32768.0f - 1.0f) * 0.05f;
+
+            float envelope = std::max(0.0f, std::sin(2.0f * pi * 3.0f * time));
+            if (static_cast<uint32_t>(time) % 3 == 2) {
+                envelope = 0.0f;
+            }
+
+            clip[index] = static_cast<int16_t>(sample * envelope * 6000.0f);
+        }
+        return clip;
+    }
+
+    //encodes the clip in 10 ms pushes the way AudioSend() does, reports CPU time and wire bitrate
+    void run(const char* name, const AudioEncoderProfile& profile, const std::vector<int16_t>& clip)
+    {
+        AudioEncoder encoder(samplerate, MUMBLE_OPUS_BITRATE, ResamplerQuality::MEDIUM, profile);
+
+        const size_t block = samplerate * block_ms / 1000;
+        size_t packets = 0;
+        size_t bytes = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t offset = 0; offset + block <= clip.size(); offset += block) {
+            encoder.Push(&clip[offset], block);
+            for (auto packet = encoder.EncodeNext(0); !packet.empty(); packet = encoder.EncodeNext(0)) {
+                packets++;
+                bytes += packet.size();
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::printf("%-12s  %8.3f ms  %6.1f us/packet  %7.0fx realtime  %6.1f kbit/s  %zu packets\n", name,
+            elapsed.count() * 1000.0, packets ? elapsed.count() * 1e6 / packets : 0.0, seconds / elapsed.count(),
+            bytes * 8.0 / seconds / 1000.0, packets);
+    }
+}
+
+int main()
+{
+    auto clip = createClip();
+
+    run("default", AudioEncoderProfile::Default(), clip);
+    run("highdensity", AudioEncoderProfile::HighDensity(), clip);
+    run("music", AudioEncoderProfile::Music(), clip);
+    run("lowdelay", AudioEncoderProfile::LowDelay(), clip);
+    return 0;
+}
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//stdlib
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+//mumlib
+#include "mumlib2_private/resampler.h"
+
+using namespace mumlib2;
+
+namespace {
+    constexpr uint32_t output_samplerate = 48000;
+    constexpr uint32_t block_ms = 10;
+    constexpr uint32_t seconds = 10;
+
+    const char* qualityName(ResamplerQuality quality)
+    {
+        switch (quality) {
+        case ResamplerQuality::FAST:
+            return "fast";
+        case ResamplerQuality::MEDIUM:
+            return "medium";
+        case ResamplerQuality::HIGH:
+            return "high";
+        case ResamplerQuality::BEST:
+            return "best";
+        }
+        return "unknown";
+    }
+
+    //feeds 10 ms blocks the way the encoder does, reports realtime factor for the whole clip
+    void run(uint32_t input_samplerate, uint32_t channels, ResamplerQuality quality)
+    {
+        Resampler resampler(input_samplerate, output_samplerate, channels, quality);
+
+        //one second clip, generated up front so only the resampler is timed
+        std::vector<int16_t> clip(static_cast<size_t>(input_samplerate) * channels);
+        for (size_t index = 0; index < clip.size(); index++) {
+            clip[index] = static_cast<int16_t>(std::sin(static_cast<float>(index / channels) * 0.05f) * 16000.0f);
+        }
+
+        const size_t block = input_samplerate * block_ms / 1000;
+        std::vector<int16_t> output(resampler.GetOutputLength(block) * channels);
+
+        size_t produced = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t second = 0; second < seconds; second++) {
+            for (size_t frame = 0; frame + block <= input_samplerate; frame += block) {
+                produced += resampler.Process(&clip[frame * channels], block, output.data(), resampler.GetOutputLength(block));
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::printf("%6u -> %u  %u ch  %-6s  %8.3f ms  %8.0fx realtime  %zu frames\n", input_samplerate, output_samplerate,
+            channels, qualityName(quality), elapsed.count() * 1000.0, seconds / elapsed.count(), produced);
+    }
+}
+
+int main()
+{
+    for (uint32_t input_samplerate : { 16000u, 44100u, 48000u }) {
+        for (uint32_t channels : { 1u, 2u }) {
+            for (auto quality : { ResamplerQuality::FAST, ResamplerQuality::MEDIUM, ResamplerQuality::HIGH, ResamplerQuality::BEST }) {
+                run(input_samplerate, channels, quality);
+            }
+        }
+    }
+    return 0;
+}
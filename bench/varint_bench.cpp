@@ -0,0 +1,234 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//stdlib
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+//mumlib
+#include "mumlib2_private/varint.h"
+
+using namespace mumlib2;
+
+namespace legacy {
+
+    //VarInt as it was before the header-only rewrite, unbounded and positive only
+    class VarInt {
+    public:
+        explicit VarInt(const uint8_t* buf)
+        {
+            parse(buf);
+        }
+
+        explicit VarInt(int64_t val) : _val(val)
+        {
+        }
+
+        [[nodiscard]] size_t Size() const
+        {
+            return _size;
+        }
+
+        [[nodiscard]] size_t Value() const
+        {
+            return _val;
+        }
+
+        [[nodiscard]] std::vector<uint8_t> Encode() const
+        {
+            std::vector<uint8_t> result;
+
+            //7 bit positive (0xxxxxxx)
+            if (_val < 0x80) {
+                result.reserve(1);
+                result.push_back(_val & 0x7F);
+                return result;
+            }
+
+            //14 bit positive (10xxxxxx + 1b)
+            if (_val < 0x4000) {
+                result.reserve(2);
+                result.push_back(static_cast<uint8_t>(0x80 | (_val >> 8)));
+                result.push_back(static_cast<uint8_t>(_val & 0xFF));
+                return result;
+            }
+
+            //21 bit positive (110xxxxx + 2b)
+            if (_val < 0x200000) {
+                result.reserve(3);
+                result.push_back(static_cast<uint8_t>(0xC0 | (_val >> 16)));
+                result.push_back(static_cast<uint8_t>((_val >> 8) & 0xFF));
+                result.push_back(static_cast<uint8_t>(_val & 0xFF));
+                return result;
+            }
+
+            //28 bit positive (1110xxxx + 3b)
+            if (_val < 0x10000000) {
+                result.reserve(4);
+                result.push_back(static_cast<uint8_t>(0xE0 | (_val >> 24)));
+                result.push_back(static_cast<uint8_t>((_val >> 16) & 0xFF));
+                result.push_back(static_cast<uint8_t>((_val >> 8) & 0xFF));
+                result.push_back(static_cast<uint8_t>(_val & 0xFF));
+                return result;
+            }
+
+            //64 bit positive (111100__ + int64)
+            result.reserve(9);
+            result.push_back(0xF4);
+            for (int shift = 56; shift >= 0; shift -= 8) {
+                result.push_back((_val >> shift) & 0xFF);
+            }
+            return result;
+        }
+
+    private:
+        void parse(const uint8_t* buf)
+        {
+            _val = buf[0];
+            _size = 0;
+
+            //7 bit positive (0xxxxxxx)
+            if ((buf[0] & 0b1000'0000) == 0b0000'0000) {
+                _val = _val & 0b0111'1111;
+                _size = 1;
+                return;
+            }
+
+            //14 bit positive (10xxxxxx + 1b)
+            if ((buf[0] & 0b1100'0000) == 0b1000'0000) {
+                _val = ((_val & 0b0011'1111) << 8) | buf[1];
+                _size = 2;
+                return;
+            }
+
+            //21 bit positive (110xxxxx + 2b)
+            if ((buf[0] & 0b1110'0000) == 0b1100'0000) {
+                _val = ((_val & 0b0001'1111) << 16) | (buf[1] << 8) | buf[2];
+                _size = 3;
+                return;
+            }
+
+            //28 bit positive (1110xxxx + 3b)
+            if ((buf[0] & 0b1111'0000) == 0b1110'0000) {
+                _val = ((_val & 0b0000'1111) << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3];
+                _size = 4;
+                return;
+            }
+
+            //64 bit positive (111101__ + int64), unaligned load as memcpy
+            if ((buf[0] & 0b1111'1100) == 0b1111'0100) {
+                uint64_t raw = 0;
+                std::memcpy(&raw, buf + 1, sizeof(raw));
+                _val = __builtin_bswap64(raw);
+                _size = 9;
+                return;
+            }
+        }
+
+    private:
+        int64_t _val = 0;
+        size_t _size = 0;
+    };
+}
+
+namespace {
+    constexpr size_t value_count = 1 << 20;
+    constexpr int rounds = 20;
+
+    //mostly short forms like sequence numbers and session ids, the odd 64 bit value
+    std::vector<int64_t> createValues()
+    {
+        std::vector<int64_t> values(value_count);
+        uint32_t state = 1;
+        for (auto& value : values) {
+            state = state * 1664525u + 1013904223u;
+            uint32_t form = (state >> 24) % 100;
+            uint32_t bits = state & 0x0FFFFFFF;
+            if (form < 50) {
+                value = bits & 0x7F;
+            }
+            else if (form < 80) {
+                value = bits & 0x3FFF;
+            }
+            else if (form < 95) {
+                value = bits & 0x1FFFFF;
+            }
+            else if (form < 99) {
+                value = bits;
+            }
+            else {
+                value = (static_cast<int64_t>(bits) << 32) | state;
+            }
+        }
+        return values;
+    }
+
+    template <typename Fn>
+    void report(const char* name, Fn&& fn)
+    {
+        uint64_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++) {
+            checksum += fn();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::printf("%-16s  %6.2f ns/value  checksum %llu\n", name, elapsed.count() * 1e9 / (value_count * rounds),
+            static_cast<unsigned long long>(checksum));
+    }
+}
+
+int main()
+{
+    auto values = createValues();
+
+    //one stream in the current encoding, every form here is identical in both implementations
+    std::vector<uint8_t> stream(values.size() * VarInt::MaxSize);
+    size_t stream_size = 0;
+    for (auto value : values) {
+        stream_size += VarInt::Encode(value, stream.data() + stream_size);
+    }
+    stream.resize(stream_size);
+
+    report("decode legacy", [&]() {
+        uint64_t sum = 0;
+        for (size_t pos = 0; pos < stream.size();) {
+            legacy::VarInt varint(stream.data() + pos);
+            sum += varint.Value();
+            pos += varint.Size();
+        }
+        return sum;
+    });
+
+    report("decode current", [&]() {
+        uint64_t sum = 0;
+        for (size_t pos = 0; pos < stream.size();) {
+            int64_t value = 0;
+            pos += VarInt::Decode(stream.data() + pos, stream.size() - pos, value);
+            sum += static_cast<uint64_t>(value);
+        }
+        return sum;
+    });
+
+    report("encode legacy", [&]() {
+        uint64_t sum = 0;
+        for (auto value : values) {
+            sum += legacy::VarInt(value).Encode().size();
+        }
+        return sum;
+    });
+
+    report("encode current", [&]() {
+        uint64_t sum = 0;
+        uint8_t buf[VarInt::MaxSize];
+        for (auto value : values) {
+            sum += VarInt::Encode(value, buf) + buf[0];
+        }
+        return sum;
+    });
+
+    return 0;
+}
@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//stdlib
+#include <cstdint>
+#include <cstdlib>
+
+//mumlib
+#include "mumlib2_private/audio_packet.h"
+#include "mumlib2_private/varint.h"
+
+using namespace mumlib2;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    //every varint form, decoded values must survive a round trip
+    for (size_t pos = 0; pos < size; pos++) {
+        int64_t value = 0;
+        if (!VarInt::Decode(data + pos, size - pos, value)) {
+            break;
+        }
+
+        uint8_t encoded[VarInt::MaxSize];
+        int64_t decoded = 0;
+        if (VarInt::Decode(encoded, VarInt::Encode(value, encoded), decoded) == 0 || decoded != value) {
+            std::abort();
+        }
+    }
+
+    //datagram as it comes off the socket, parsed into a reused packet like the io thread does
+    static AudioPacket packet;
+    if (AudioPacket::Parse(data, size, 0, packet) != AudioPacketError::NONE) {
+        return 0;
+    }
+
+    //accepted packets must be internally consistent
+    if (packet.GetHeaderType() == AudioPacketType::Opus && packet.GetAudioPayload().size() > size) {
+        std::abort();
+    }
+
+    return 0;
+}
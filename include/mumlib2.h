@@ -4,7 +4,9 @@
 #pragma once
 
 //stdlib
+#include <chrono>
 #include <cstdint>
+#include <functional>
 #include <optional>
 #include <stdexcept>
 #include <string>
@@ -12,6 +14,7 @@
 #include <memory>
 
 //mumlib
+#include "mumlib2/audio_frame.h"
 #include "mumlib2/callback.h"
 #include "mumlib2/constants.h"
 #include "mumlib2/enums.h"
@@ -19,6 +22,8 @@
 #include "mumlib2/exceptions.h"
 #include "mumlib2/logger.h"
 #include "mumlib2/structs.h"
+#include "mumlib2/tls_context.h"
+#include "mumlib2/transport_error.h"
 
 namespace mumlib2 {
 
@@ -37,12 +42,54 @@ namespace mumlib2 {
         //acl
         bool AclSetTokens(const std::vector<std::string>& tokens);
 
+        //audio
+        bool AudioSetBitrate(uint32_t bitrate);
+        bool AudioSetEncoderProfile(const AudioEncoderProfile& profile);
+        void AudioSetFrameAllocator(std::shared_ptr<AudioFrameAllocator> allocator);
+        bool AudioSetFrameDuration(uint32_t frame_duration_ms, uint32_t frames_per_packet = 1);
+        void AudioSetPassthrough(bool enabled);
+        bool AudioSetPanning(bool enabled);
+        void AudioSetListener(float x, float y, float z, float forward_x = 0.0f, float forward_y = 0.0f, float forward_z = 1.0f);
+        void AudioSetPosition(float x, float y, float z);
+        void AudioClearPosition();
+        bool AudioSetOutputFormat(AudioSampleFormat format, uint32_t channels = MUMBLE_AUDIO_CHANNELS);
+        bool AudioSetInputSamplerate(uint32_t samplerate, ResamplerQuality quality = MUMBLE_RESAMPLER_QUALITY);
+        bool AudioSetOutputSamplerate(uint32_t samplerate, ResamplerQuality quality = MUMBLE_RESAMPLER_QUALITY);
+        //false when options are out of range
+        bool AudioSetSendThread(bool enabled, const ThreadOptions& options = ThreadOptions());
+
+        //audio subscription, when nothing is subscribed every speaker is delivered
+        void AudioSubscribeSession(int32_t session_id, bool subscribe = true);
+        void AudioSubscribeChannel(int32_t channel_id, bool subscribe = true);
+        void AudioSubscribePredicate(std::function<bool(const MumbleUser&)> predicate);
+        void AudioSubscribeReset();
+
         //channel
         std::string ChannelCurrentGetName();
         int32_t ChannelCurrentGetId();
         bool ChannelJoin(const std::string& channel_name);
         bool ChannelJoin(int channel_id);
 
+        //dispatch, only while not connected, false when the policies are not allowed for their class
+        bool DispatchSetOptions(const DispatchOptions& options);
+
+        //delivers queued callback events on the calling thread, waits up to wait for the first one,
+        //returns events delivered
+        size_t DispatchPump(std::chrono::milliseconds wait = std::chrono::milliseconds(0), size_t max_events = SIZE_MAX);
+
+        //statistics, thread-safe
+        Statistics StatisticsGet();
+        std::vector<SpeakerStatistics> StatisticsGetSpeakers();
+
+        //tracing, process-wide, spans of the last capacity trace points are kept and callbacks running
+        //for slow_callback or longer are counted in trace_slow_callbacks, false when the library was
+        //built without MUMLIB2_ENABLE_TRACING
+        static bool TraceStart(size_t capacity = MUMBLE_TRACE_CAPACITY, std::chrono::microseconds slow_callback = std::chrono::microseconds(MUMBLE_TRACE_SLOW_CALLBACK_US));
+        static void TraceStop();
+
+        //writes the recorded spans as Chrome trace event JSON, open with Perfetto or chrome://tracing
+        static bool TraceExport(const std::string& path);
+
         //user
         std::optional<MumbleUser> UserGet(int32_t session_id);
         std::vector<MumbleUser> UserGetInChannel(int32_t channel_id);
@@ -55,20 +102,46 @@ namespace mumlib2 {
         //
         bool connect(string host, int port, string user, string password);
 
+        //safe from any thread and from callbacks, from a callback the connection is released
+        //once run() returns and connect() fails until then
         void disconnect();
 
+        //returns when the connection is closed, by disconnect() or by an error
         void run();
 
+        //like run() on a thread owned by the library, call after connect(), joined by disconnect(),
+        //false when already running or options are out of range
+        bool runThread(const ThreadOptions& options = ThreadOptions());
+
+        //error that closed the connection, empty after a clean disconnect
+        std::error_code TransportGetError();
+
+        //reconnect in the background instead of returning from run(), channel, voice targets,
+        //access tokens and local mutes are restored, takes effect with the next connect()
+        void TransportSetReconnect(bool enabled, uint32_t delay_min_ms = MUMBLE_RECONNECT_DELAY_MIN_MS, uint32_t delay_max_ms = MUMBLE_RECONNECT_DELAY_MAX_MS);
+
+        //socket QoS and buffers, false when dscp is out of range, takes effect with the next connect()
+        bool TransportSetOptions(const TransportOptions& options);
+
+        //share certificate and TLS session cache with other instances, takes effect with the next connect()
+        void TransportSetTlsContext(std::shared_ptr<TlsContext> context);
+
         ConnectionState getConnectionState();
 
         vector<MumbleUser> getListAllUser();
 
         vector<MumbleChannel> getListAllChannel();
 
+        //safe to call from several threads, calls are serialized and their samples queued in call order
         void sendAudioData(const int16_t *pcmData, int pcmLength);
 
         void sendAudioDataTarget(int targetId, const int16_t *pcmData, int pcmLength);
 
+        //ends the talk spurt, the remaining partial frame is padded with silence and marked as last
+        void sendAudioEnd(int targetId = 0);
+
+        bool sendEncodedOpus(int targetId, int64_t sequenceNumber, const uint8_t *payload, size_t payloadLength, bool is_last);
+
         void sendTextMessage(std::string message);
 
         void sendVoiceTarget(int targetId, VoiceTargetType type, int sessionId);
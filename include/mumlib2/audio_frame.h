@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+#pragma once
+
+//stdlib
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+//mumlib
+#include "mumlib2/enums.h"
+#include "mumlib2/export.h"
+
+namespace mumlib2 {
+
+    /* Source of memory for decoded audio frames.
+     *
+     * Called from the io thread when a frame is created, and from whichever
+     * thread drops the last reference to it when the frame is released.
+     * Returned memory must be aligned for any scalar type, nullptr reports
+     * exhaustion and the frame is then delivered through the copying callback.
+     */
+    class MUMLIB2_EXPORT AudioFrameAllocator {
+    public:
+        virtual ~AudioFrameAllocator() = default;
+
+        virtual void* Allocate(size_t size) = 0;
+        virtual void Deallocate(void* ptr, size_t size) = 0;
+    };
+
+    /* Lock-free slab of equally sized blocks.
+     *
+     * Blocks are claimed with a single compare-exchange on a per-block flag, so
+     * frames may be released from any thread. Requests that do not fit a block or
+     * arrive while the slab is exhausted fall back to the heap.
+     */
+    class MUMLIB2_EXPORT AudioFramePool : public AudioFrameAllocator {
+    public:
+        //mark as non-copyable
+        AudioFramePool(const AudioFramePool&) = delete;
+        AudioFramePool& operator=(const AudioFramePool&) = delete;
+
+        //default block holds 20 ms of 48 kHz stereo float
+        explicit AudioFramePool(size_t block_count, size_t block_size = 0);
+        ~AudioFramePool() override;
+
+        void* Allocate(size_t size) override;
+        void Deallocate(void* ptr, size_t size) override;
+
+        [[nodiscard]] size_t GetBlockSize() const;
+        [[nodiscard]] size_t GetBlockCount() const;
+
+    private:
+        size_t _block_size = 0;
+        size_t _block_count = 0;
+
+        uint8_t* _storage = nullptr;
+        std::unique_ptr<std::atomic<bool>[]> _used;
+        std::atomic<size_t> _hint = 0;
+    };
+
+    /* Reference counted handle to decoded audio.
+     *
+     * Metadata and samples share one allocation from the AudioFrameAllocator.
+     * Copies are cheap and may be handed to other threads, memory goes back to
+     * the allocator when the last handle is destroyed.
+     */
+    class MUMLIB2_EXPORT AudioFrame {
+    public:
+        AudioFrame() = default;
+        AudioFrame(const AudioFrame& other);
+        AudioFrame(AudioFrame&& other) noexcept;
+        AudioFrame& operator=(const AudioFrame& other);
+        AudioFrame& operator=(AudioFrame&& other) noexcept;
+        ~AudioFrame();
+
+        //returns empty frame when allocation fails
+        static AudioFrame Create(std::shared_ptr<AudioFrameAllocator> allocator, AudioSampleFormat format, uint32_t channels, uint32_t samplerate, size_t capacity);
+
+        //bytes needed for a frame of given shape, useful for sizing pools
+        static size_t GetAllocationSize(AudioSampleFormat format, uint32_t channels, size_t capacity);
+
+        explicit operator bool() const;
+
+        //shape
+        [[nodiscard]] AudioSampleFormat GetFormat() const;
+        [[nodiscard]] uint32_t GetChannels() const;
+        [[nodiscard]] uint32_t GetSamplerate() const;
+        [[nodiscard]] size_t GetCapacity() const;
+        [[nodiscard]] size_t GetFrames() const;
+        void SetFrames(size_t frames);
+
+        //stream
+        [[nodiscard]] uint32_t GetTarget() const;
+        [[nodiscard]] int32_t GetSessionId() const;
+        [[nodiscard]] int64_t GetSequenceNumber() const;
+        [[nodiscard]] bool IsLast() const;
+        void SetStream(uint32_t target, int32_t session_id, int64_t sequence_number, bool is_last);
+
+        //speaker position, when sent
+        [[nodiscard]] bool HasPosition() const;
+        [[nodiscard]] std::array<float, 3> GetPosition() const;
+        void SetPosition(const std::array<float, 3>& position);
+
+        //interleaved samples, nullptr when format differs
+        [[nodiscard]] const int16_t* GetInt16() const;
+        [[nodiscard]] const float* GetFloat() const;
+        int16_t* GetInt16();
+        float* GetFloat();
+
+    private:
+        struct Header;
+
+        explicit AudioFrame(Header* header);
+        void release();
+
+        [[nodiscard]] uint8_t* data() const;
+
+    private:
+        Header* _header = nullptr;
+    };
+}
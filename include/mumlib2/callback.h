@@ -6,9 +6,11 @@
 //stdlib
 #include <cstdint>
 #include <string>
+#include <system_error>
 #include <vector>
 
 //mumlib2
+#include "mumlib2/audio_frame.h"
 #include "mumlib2/export.h"
 
 namespace mumlib2 {
@@ -33,6 +35,38 @@ namespace mumlib2 {
                 const int16_t* audio_buf,
                 size_t samples_count) { };
 
+        //called before the audio callbacks for packets carrying speaker position
+        virtual void audioPosition(
+                int target,
+                int sessionId,
+                int sequenceNumber,
+                float x,
+                float y,
+                float z) { };
+
+        //called instead of audio() when float output is selected, samples_count is in frames
+        virtual void audioFloat(
+                int target,
+                int sessionId,
+                int sequenceNumber,
+                bool is_last,
+                const float* audio_buf,
+                size_t samples_count,
+                uint32_t channels) { };
+
+        //called instead of audio() and audioFloat() when a frame allocator is set,
+        //copy the handle to keep the samples beyond the call
+        virtual void audioFrame(const AudioFrame& frame) { };
+
+        //called instead of audio() when passthrough is enabled
+        virtual void encodedAudio(
+                int target,
+                int sessionId,
+                int sequenceNumber,
+                bool is_last,
+                const uint8_t *encoded_audio_data,
+                uint32_t encoded_audio_data_size) { };
+
         virtual void unsupportedAudio(
                 int target,
                 int sessionId,
@@ -157,5 +191,17 @@ namespace mumlib2 {
             uint32_t idlesecs
 			) { };
 
+        //called from the io thread on every change of the connection state, RECONNECTING means
+        //users and channels were cleared and will be sent again by the server
+        virtual void connectionState(ConnectionState state) { };
+
+        //called from the io thread when the connection runs into a transport error that changes its state,
+        //see transport_error_policy() for what happens next
+        virtual void transportError(const std::error_code& error) { };
+
+        //called from the io thread when voice moves between UDP and the TLS tunnel,
+        //UDP is used again once a UDP ping is answered
+        virtual void udpState(bool active) { };
+
     };
 }
@@ -6,14 +6,28 @@
 //stdlib
 #include <cstdint>
 
+//mumlib
+#include "mumlib2/enums.h"
+
 namespace mumlib2 {
     constexpr uint32_t MUMBLE_AUDIO_CHANNELS   = 1;
     constexpr uint32_t MUMBLE_AUDIO_SAMPLERATE = 48000;
 
-    constexpr uint32_t MUMBLE_OPUS_BITRATE    = 48000;
-    constexpr uint32_t MUMBLE_OPUS_MAXLENGTH  = 60;
+    constexpr uint32_t MUMBLE_OPUS_BITRATE       = 48000;
+    constexpr uint32_t MUMBLE_OPUS_BITRATE_MIN   = 8000;
+    constexpr uint32_t MUMBLE_OPUS_BITRATE_MAX   = 510000;
+    constexpr uint32_t MUMBLE_OPUS_FRAMEDURATION = 20;
+    constexpr uint32_t MUMBLE_OPUS_MAXLENGTH     = 60;
+
+    constexpr ResamplerQuality MUMBLE_RESAMPLER_QUALITY = ResamplerQuality::MEDIUM;
+    constexpr uint32_t MUMBLE_RESAMPLER_SAMPLERATE_MIN  = 8000;
+    constexpr uint32_t MUMBLE_RESAMPLER_SAMPLERATE_MAX  = 192000;
+
+    constexpr uint32_t MUMBLE_RECONNECT_DELAY_MIN_MS = 500;
+    constexpr uint32_t MUMBLE_RECONNECT_DELAY_MAX_MS = 30000;
 
-    constexpr uint32_t MUMBLE_RESAMPLER_QUALITY = 3;
+    constexpr uint32_t MUMBLE_TRACE_CAPACITY         = 65536;
+    constexpr uint32_t MUMBLE_TRACE_SLOW_CALLBACK_US = 2000;
 
     constexpr uint32_t MUMBLE_UDP_MAXLENGTH = 1024;
     constexpr uint32_t MUMBLE_TCP_MAXLENGTH = 129 * 1024;
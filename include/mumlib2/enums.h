@@ -41,7 +41,8 @@ namespace mumlib2 {
         IN_PROGRESS = 1,
         CONNECTED = 2,
         DISCONNECTING = 3,
-        FAILED = 4
+        FAILED = 4,
+        RECONNECTING = 5
     };
 
 	enum class AudioPacketType : uint8_t {
@@ -52,6 +53,15 @@ namespace mumlib2 {
         Opus      = 0b10000000,
 	};
 
+    enum class AudioPacketError {
+        NONE,
+        TRUNCATED,
+        PAYLOAD_LENGTH,
+        POSITION_LENGTH,
+        TRAILING_DATA,
+        UNKNOWN_TYPE
+    };
+
     enum class UserState {
         MUTE,
         DEAF,
@@ -68,6 +78,53 @@ namespace mumlib2 {
         USER
     };
 
+    enum class ResamplerQuality {
+        FAST,
+        MEDIUM,
+        HIGH,
+        BEST
+    };
+
+    enum class AudioSampleFormat {
+        INT16,
+        FLOAT32
+    };
+
+    enum class AudioApplication {
+        VOIP,
+        AUDIO,
+        LOW_DELAY
+    };
+
+    enum class AudioBitrateMode {
+        CBR,
+        VBR,
+        CVBR
+    };
+
+    enum class AudioSignal {
+        AUTO,
+        VOICE,
+        MUSIC
+    };
+
+    enum class AudioBandwidth {
+        NARROWBAND,
+        MEDIUMBAND,
+        WIDEBAND,
+        SUPERWIDEBAND,
+        FULLBAND
+    };
+
+    enum class DispatchPolicy {
+        //producer waits for room, backpressure on the io thread
+        BLOCK,
+        DROP_NEWEST,
+        DROP_OLDEST,
+        //only the latest event per key is delivered
+        COALESCE
+    };
+
     enum class PingState {
         PING,
         PONG,
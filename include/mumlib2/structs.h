@@ -5,9 +5,197 @@
 
 //stdlib
 #include <cstdint>
+#include <functional>
 #include <string>
 
+//mumlib
+#include "mumlib2/enums.h"
+
 namespace mumlib2 {
+    struct AudioEncoderProfile {
+        AudioApplication application = AudioApplication::VOIP;
+        AudioBitrateMode bitrate_mode = AudioBitrateMode::CBR;
+        AudioSignal signal = AudioSignal::AUTO;
+        AudioBandwidth max_bandwidth = AudioBandwidth::FULLBAND;
+
+        //0 (fastest) .. 10 (best quality)
+        uint32_t complexity = 10;
+
+        //discontinuous transmission, silence is coded with 1-2 byte frames
+        bool dtx = false;
+
+        //single stream, best quality
+        static constexpr AudioEncoderProfile Default() {
+            return {};
+        }
+
+        //many concurrent streams, speech only, trades quality for CPU time
+        static constexpr AudioEncoderProfile HighDensity() {
+            return { AudioApplication::VOIP, AudioBitrateMode::VBR, AudioSignal::VOICE, AudioBandwidth::WIDEBAND, 2, true };
+        }
+
+        //music and other non-speech sources
+        static constexpr AudioEncoderProfile Music() {
+            return { AudioApplication::AUDIO, AudioBitrateMode::CVBR, AudioSignal::MUSIC, AudioBandwidth::FULLBAND, 10, false };
+        }
+
+        //lowest algorithmic delay, disables the speech optimized modes
+        static constexpr AudioEncoderProfile LowDelay() {
+            return { AudioApplication::LOW_DELAY, AudioBitrateMode::CBR, AudioSignal::AUTO, AudioBandwidth::FULLBAND, 10, false };
+        }
+    };
+
+
+    struct TransportOptions {
+        //IP DSCP of voice and control packets, 46 is expedited forwarding, -1 keeps the system default
+        int32_t dscp = -1;
+
+        //kernel socket buffers in bytes, 0 keeps the system default
+        uint32_t receive_buffer = 0;
+        uint32_t send_buffer = 0;
+
+        //microseconds the kernel busy polls the device for UDP receive, Linux only, 0 disables
+        uint32_t busy_poll_us = 0;
+
+        //kernel receive timestamps on the UDP socket, Linux only, keeps our own scheduling delay out of
+        //speaker jitter and feeds udp_receive_delay_us
+        bool timestamps = false;
+
+        static constexpr TransportOptions Default() {
+            return {};
+        }
+
+        //marked for priority queueing, buffers hold bursts of a few hundred voice packets
+        static constexpr TransportOptions Voice() {
+            return { 46, 256 * 1024, 256 * 1024, 0, false };
+        }
+    };
+
+    struct ThreadOptions {
+        //bit n pins the thread to CPU n, 0 keeps the inherited affinity
+        uint64_t cpu_mask = 0;
+
+        //SCHED_FIFO priority 1..99, 0 keeps normal scheduling
+        int32_t realtime_priority = 0;
+
+        //-20..19, applied to the thread only
+        int32_t nice = 0;
+
+        //mlockall() for the whole process, keeps voice buffers out of swap and page faults
+        bool lock_memory = false;
+    };
+
+    struct DispatchOptions {
+        //false calls Callback on the io thread, true queues events for DispatchPump()
+        bool queued = false;
+
+        //events per queue, rounded up to a power of two
+        uint32_t capacity = 1024;
+
+        //audio, audioFloat, audioFrame, audioPosition, encodedAudio and unsupportedAudio, COALESCE not allowed
+        DispatchPolicy audio = DispatchPolicy::DROP_OLDEST;
+
+        //events carrying complete state: udpState, userStats, permissionQuery, codecVersion and serverConfig,
+        //DROP_OLDEST not allowed
+        DispatchPolicy state = DispatchPolicy::COALESCE;
+
+        //everything else, BLOCK or DROP_NEWEST
+        DispatchPolicy control = DispatchPolicy::BLOCK;
+
+        //called on the io thread when the queues turn non-empty, e.g. to post DispatchPump() to an executor
+        std::function<void()> notify;
+    };
+
+    struct Statistics {
+        //voice packets from the server, over UDP or tunneled through the control channel
+        uint64_t audio_packets_received = 0;
+
+        //voice packets dropped because they failed validation
+        uint64_t audio_packets_malformed = 0;
+
+        //voice packets dropped because the Opus decoder rejected them
+        uint64_t audio_packets_undecodable = 0;
+
+        //UDP datagrams that failed authentication
+        uint64_t udp_packets_decrypt_failed = 0;
+
+        //UDP datagrams dropped before crypt setup, or too large to send
+        uint64_t udp_packets_dropped = 0;
+
+        //voice currently goes over UDP
+        bool udp_active = false;
+
+        //times voice moved to the TLS tunnel because UDP failed or stopped answering pings
+        uint64_t udp_fallbacks = 0;
+
+        //times voice moved back to UDP after a ping was answered
+        uint64_t udp_recoveries = 0;
+
+        //UDP pings, loss is 1 - received / sent
+        uint64_t udp_pings_sent = 0;
+        uint64_t udp_pings_received = 0;
+
+        //smoothed round trip times, 0 until measured
+        uint32_t udp_ping_rtt_ms = 0;
+        uint32_t tcp_ping_rtt_ms = 0;
+
+        //reconnect attempts started after a connection failed
+        uint64_t reconnects = 0;
+
+        //TLS handshakes that resumed the previous session
+        uint64_t tls_sessions_resumed = 0;
+
+        //server nonce resyncs requested after UDP decrypt failure streaks, and resyncs applied
+        uint64_t crypt_resync_requests = 0;
+        uint64_t crypt_resyncs = 0;
+
+        //datagrams the kernel dropped on the UDP socket because its receive buffer was full, Linux only
+        uint64_t udp_kernel_drops = 0;
+
+        //io thread timer ticks that ran more than 5 ms late, and the worst lateness seen
+        uint64_t io_deadline_misses = 0;
+        uint32_t io_lateness_max_us = 0;
+
+        //time UDP datagrams waited in the socket before the io thread read them, needs kernel timestamps,
+        //see TransportOptions::timestamps
+        uint32_t udp_receive_delay_us = 0;
+        uint32_t udp_receive_delay_max_us = 0;
+
+        //packets of the current audio send thread that went out more than 2 ms after their deadline
+        uint64_t audio_send_deadline_misses = 0;
+
+        //queued callback events, now and at most, and events dropped or replaced by policy
+        uint64_t dispatch_queue_depth = 0;
+        uint64_t dispatch_queue_depth_max = 0;
+        uint64_t dispatch_events_dropped = 0;
+        uint64_t dispatch_events_coalesced = 0;
+
+        //process-wide, callbacks over the slow threshold since TraceStart()
+        uint64_t trace_slow_callbacks = 0;
+
+        //from connect or reconnect start to ServerSync of the current connection
+        uint32_t time_to_server_sync_ms = 0;
+    };
+
+    struct SpeakerStatistics {
+        int32_t session_id = -1;
+        uint64_t packets = 0;
+
+        //RFC 3550 interarrival jitter of the voice packets
+        uint32_t jitter_us = 0;
+
+        //smoothed one-way delay above the lowest of the current talk spurt, grows while a queue builds up on the path
+        uint32_t delay_trend_us = 0;
+
+        //from arrival until the audio was handed to the application, smoothed and worst
+        uint32_t processing_latency_us = 0;
+        uint32_t processing_latency_max_us = 0;
+
+        //arrival of the last packet was taken by the kernel, otherwise by the io thread,
+        //which adds our own scheduling delay to the jitter
+        bool kernel_timestamps = false;
+    };
+
     struct MumbleUser {
         int32_t sessionId = -1;
         int32_t channelId = -1;
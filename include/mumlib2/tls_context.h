@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+#pragma once
+
+//stdlib
+#include <cstddef>
+#include <memory>
+#include <string>
+
+//mumlib
+#include "mumlib2/export.h"
+
+namespace mumlib2 {
+
+    class TlsContextPrivate;
+
+    /* TLS settings and client certificate shared by many connections.
+     *
+     * Certificate and key are parsed once when the context is created and do not
+     * change afterwards, so one context may be handed to any number of Mumlib2
+     * instances on any threads. Sessions of established connections are cached per
+     * host and port, the next connection to the same server resumes them instead
+     * of doing a full handshake.
+     */
+    class MUMLIB2_EXPORT TlsContext {
+    public:
+        //mark as non-copyable
+        TlsContext(const TlsContext&) = delete;
+        TlsContext& operator=(const TlsContext&) = delete;
+
+        ~TlsContext();
+
+        //PEM files, empty paths leave the client certificate out, throws TransportException when unreadable
+        static std::shared_ptr<TlsContext> FromFiles(const std::string& cert_file, const std::string& key_file);
+
+        //PEM text, empty strings leave the client certificate out, throws TransportException when invalid
+        static std::shared_ptr<TlsContext> FromMemory(const std::string& cert_pem, const std::string& key_pem);
+
+        [[nodiscard]] size_t GetSessionCount() const;
+
+        //next connections do full handshakes, e.g. after the server changed its certificate
+        void ClearSessions();
+
+    private:
+        friend class Transport;
+
+        TlsContext();
+
+    private:
+        std::unique_ptr<TlsContextPrivate> impl;
+    };
+}
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+#pragma once
+
+//stdlib
+#include <system_error>
+
+//mumlib
+#include "mumlib2/export.h"
+
+namespace mumlib2 {
+
+    enum class TransportError {
+        //connection, closed
+        CONNECT_FAILED = 1,
+        HANDSHAKE_FAILED,
+        TLS_RECEIVE_FAILED,
+        TLS_SEND_FAILED,
+        MESSAGE_TOO_LARGE,
+        REJECTED,
+        PING_TIMEOUT,
+
+        //voice channel, falls back to the TLS tunnel
+        CRYPT_SETUP_INVALID,
+        UDP_RECEIVE_FAILED,
+        UDP_SEND_FAILED,
+
+        //single packet, dropped and counted
+        UDP_DECRYPT_FAILED,
+        UDP_BEFORE_CRYPT_SETUP,
+        UDP_PACKET_TOO_LARGE
+    };
+
+    //what the transport does when it runs into an error
+    enum class TransportErrorPolicy {
+        DROP,
+        FALLBACK_TCP,
+        CLOSE
+    };
+
+    MUMLIB2_EXPORT const std::error_category& transport_category();
+
+    MUMLIB2_EXPORT std::error_code make_error_code(TransportError error);
+
+    MUMLIB2_EXPORT TransportErrorPolicy transport_error_policy(TransportError error);
+}
+
+template <>
+struct std::is_error_code_enum<mumlib2::TransportError> : std::true_type {};
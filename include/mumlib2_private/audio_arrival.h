@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+#pragma once
+
+//stdlib
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+//mumlib
+#include "mumlib2/structs.h"
+
+namespace mumlib2 {
+
+    /* Per-speaker arrival timing of voice packets.
+     *
+     * The sender clock is rebuilt from sequence numbers, which count 10 ms of
+     * audio. Transit is arrival minus sender clock, its changes give the RFC 3550
+     * interarrival jitter and its rise above the lowest value of the talk spurt
+     * gives the queueing delay trend on the path. Processing latency is measured
+     * separately, from arrival until the packet was handed to the application.
+     * Updated on the io thread, read from user threads.
+     */
+    class AudioArrival {
+    public:
+        //mark as non-copyable
+        AudioArrival(const AudioArrival&) = delete;
+        AudioArrival& operator=(const AudioArrival&) = delete;
+
+        //ctor/dtor
+        AudioArrival() = default;
+        ~AudioArrival() = default;
+
+        //kernel tells whether arrival was taken by the kernel or by the io thread
+        void Update(int32_t session_id, int64_t sequence_number, std::chrono::system_clock::time_point arrival, bool kernel);
+        void UpdateProcessing(int32_t session_id, std::chrono::system_clock::duration latency);
+
+        void Erase(int32_t session_id);
+        void Clear();
+
+        [[nodiscard]] std::vector<SpeakerStatistics> Get() const;
+
+    private:
+        struct Speaker {
+            SpeakerStatistics statistics;
+
+            int64_t sequence_last = 0;
+            int64_t arrival_last_us = 0;
+            int64_t transit_last_us = 0;
+            int64_t transit_min_us = 0;
+
+            //fixed point, 16 times the value as in RFC 3550 A.8
+            int64_t jitter_us_16 = 0;
+            int64_t transit_us_16 = 0;
+        };
+
+    private:
+        mutable std::mutex _mutex;
+        std::map<int32_t, Speaker> _speakers;
+
+    private:
+        //sender restarts its sequence numbers after a pause, a gap this long starts a new talk spurt
+        static constexpr std::chrono::microseconds _spurt_gap = std::chrono::seconds(1);
+
+        //duration of one sequence number step
+        static constexpr int64_t _sequence_us = 10000;
+    };
+}
@@ -13,6 +13,7 @@
 #include <opus/opus.h>
 
 //mumlib
+#include "mumlib2/constants.h"
 #include "mumlib2/logger.h"
 #include "mumlib2_private/audio_decoder_session.h"
 #include "mumlib2_private/audio_packet.h"
@@ -25,18 +26,38 @@ namespace mumlib2 {
         AudioDecoder& operator=(const AudioDecoder&) = delete;
         
         //ctor/dtor
-        explicit AudioDecoder(uint32_t channels);
+        AudioDecoder(uint32_t channels, uint32_t output_samplerate, ResamplerQuality quality, AudioSampleFormat format, AudioPanner* panner);
         ~AudioDecoder();
 
         std::pair<const int16_t*, size_t> Process(const AudioPacket& packet);
+        std::pair<const float*, size_t> ProcessFloat(const AudioPacket& packet);
+
+        //decodes into caller memory, returns frames written
+        size_t ProcessInto(const AudioPacket& packet, int16_t* output, size_t output_frames);
+        size_t ProcessInto(const AudioPacket& packet, float* output, size_t output_frames);
+        [[nodiscard]] size_t GetOutputLength(const AudioPacket& packet);
+
+        [[nodiscard]] uint32_t GetChannels() const;
+        [[nodiscard]] AudioSampleFormat GetFormat() const;
+        [[nodiscard]] uint32_t GetSamplerate() const;
+
+        //unsubscribed speaker, nothing is decoded
+        void Skip(const AudioPacket& packet);
 
     private:
         Logger _logger = Logger("mumlib/AudioDecoder");
 
         uint32_t _channels = 0;
+        uint32_t _output_samplerate = 0;
+        ResamplerQuality _resampler_quality = MUMBLE_RESAMPLER_QUALITY;
+        AudioSampleFormat _format = AudioSampleFormat::INT16;
+        AudioPanner* _panner = nullptr;
 
         const std::chrono::seconds _timeout_inactivity = std::chrono::seconds(300);
 
         std::map<int32_t, std::unique_ptr<AudioDecoderSession>> _sessions;
+
+    private:
+        AudioDecoderSession& sessionGet(int32_t session_id);
     };
 }
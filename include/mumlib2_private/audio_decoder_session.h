@@ -13,8 +13,11 @@
 #include <opus/opus.h>
 
 //mumlib
+#include "mumlib2/enums.h"
 #include "mumlib2/logger.h"
 #include "mumlib2_private/audio_packet.h"
+#include "mumlib2_private/audio_panner.h"
+#include "mumlib2_private/resampler.h"
 
 namespace mumlib2 {
     class AudioDecoderSession {
@@ -24,19 +27,38 @@ namespace mumlib2 {
         AudioDecoderSession& operator=(const AudioDecoderSession&) = delete;
         
         //ctor/dtor
-        explicit AudioDecoderSession(int32_t session_id, uint32_t channels);
+        AudioDecoderSession(int32_t session_id, uint32_t channels, uint32_t output_samplerate, ResamplerQuality quality, AudioSampleFormat format, AudioPanner* panner);
         ~AudioDecoderSession();
 
+        //returned length is in frames, samples are interleaved by channel
         std::pair<const int16_t*, size_t> Process(const AudioPacket& packet);
+        std::pair<const float*, size_t> ProcessFloat(const AudioPacket& packet);
+
+        //decodes into caller memory, returns frames written
+        size_t ProcessInto(const AudioPacket& packet, int16_t* output, size_t output_frames);
+        size_t ProcessInto(const AudioPacket& packet, float* output, size_t output_frames);
+
+        //upper bound of frames the packet decodes to
+        [[nodiscard]] size_t GetOutputLength(const AudioPacket& packet) const;
+
+        //packet is dropped undecoded, decoder state is reset once decoding resumes
+        void Skip();
 
         std::chrono::time_point<std::chrono::steady_clock> GetLastTimepoint();
 
     private:
         void opusCreate();
-        size_t opusDecode(const uint8_t* in_data, size_t in_len);
+        size_t opusDecode(const uint8_t* in_data, size_t in_len, int16_t* out_data, size_t out_len);
+        size_t opusDecode(const uint8_t* in_data, size_t in_len, float* out_data, size_t out_len);
         void opusDestroy();
         void opusResize();
 
+        template <typename T>
+        void pan(const AudioPacket& packet, T* output, size_t output_frames);
+
+        template <typename T>
+        size_t process(const AudioPacket& packet, T* output, size_t output_frames, std::vector<T>& opus_buf);
+
         void reset();
 
     private:
@@ -44,9 +66,19 @@ namespace mumlib2 {
 
         OpusDecoder* _opus = nullptr;
         std::vector<int16_t> _opus_output_buf;
+        std::vector<float> _opus_output_float;
+
+        AudioPanner* _panner = nullptr;
+        std::pair<float, float> _pan_gains{ 1.0f, 1.0f };
+
+        std::unique_ptr<Resampler> _resampler;
+        std::vector<int16_t> _resampler_output_buf;
+        std::vector<float> _resampler_output_float;
 
         uint32_t _channels = 0;
+        AudioSampleFormat _format = AudioSampleFormat::INT16;
         int32_t _session_id;
+        bool _stale = false;
 
         std::chrono::time_point<std::chrono::steady_clock> _timepoint_last;
     };
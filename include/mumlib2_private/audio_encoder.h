@@ -4,17 +4,25 @@
 #pragma once
 
 //stdlib
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <vector>
 
 //opus
 #include <opus/opus.h>
 
 //mumlib
+#include "mumlib2/constants.h"
 #include "mumlib2/logger.h"
+#include "mumlib2/structs.h"
 #include "mumlib2_private/audio_packet.h"
+#include "mumlib2_private/audio_ring_buffer.h"
+#include "mumlib2_private/resampler.h"
 
 namespace mumlib2 {
     class AudioEncoder {
@@ -22,34 +30,90 @@ namespace mumlib2 {
         //mark as non-copyable
         AudioEncoder(const AudioEncoder&) = delete;
         AudioEncoder& operator=(const AudioEncoder&) = delete;
-        
+
         //ctor/dtor
-        explicit AudioEncoder(uint32_t output_bitrate);
+        AudioEncoder(uint32_t input_samplerate, uint32_t output_bitrate, ResamplerQuality quality, const AudioEncoderProfile& profile);
         ~AudioEncoder();
 
-        std::vector<uint8_t> Encode(const int16_t* pcmData, size_t pcmLength, uint32_t target);
+        //producer side, accepts any amount of samples, returns amount of samples queued
+        size_t Push(const int16_t* pcmData, size_t pcmLength);
+
+        //consumer side, returns empty vector until a whole packet is accumulated
+        std::vector<uint8_t> EncodeNext(uint32_t target);
+
+        //ends the stream once queued input is encoded, the partial frame is zero padded
+        //and sent with the terminator flag, safe to call from any thread
+        void Flush();
+
+        [[nodiscard]] std::chrono::milliseconds GetPacketDuration() const;
 
+        //applied at the next packet boundary, safe to call from any thread
         void SetBitrate(uint32_t bitrate);
+        bool SetFrameDuration(uint32_t frame_duration_ms, uint32_t frames_per_packet);
+
+        //attached to every following packet, safe to call from any thread
+        void SetPosition(const std::optional<std::array<float, 3>>& position);
 
     private:
         void reset();
 
         void createOpus();
         void destroyOpus();
+        void applyProfile();
 
+        void applyBitrate();
+        void applyFrameDuration();
+        bool fillFrame();
+        std::vector<uint8_t> encodeFrame(uint32_t target, bool last);
+        std::vector<uint8_t> repacketize(uint32_t target, bool last);
+        std::vector<uint8_t> flush(uint32_t target);
+        std::vector<uint8_t> createPacket(uint32_t target, const uint8_t* payload, size_t payload_len, bool last);
 
     private:
         Logger logger = Logger("mumlib/AudioEncoder");
 
         OpusEncoder* _encoder = nullptr;
-        std::vector<uint8_t> _encoder_buf;
-        
+        OpusRepacketizer* _repacketizer = nullptr;
+
         uint32_t _channels = 0;
+        AudioEncoderProfile _profile;
+
+        //input
+        AudioRingBuffer _input;
+        std::vector<int16_t> _input_buf;
+        std::unique_ptr<Resampler> _resampler;
+        std::atomic<std::chrono::high_resolution_clock::time_point> _push_timestemp;
+        std::atomic<bool> _flush_requested = false;
+
+        //bitrate
+        std::atomic<uint32_t> _bitrate_requested = MUMBLE_OPUS_BITRATE;
+        uint32_t _bitrate = 0;
+
+        //framing
+        std::atomic<uint32_t> _frame_duration_requested = MUMBLE_OPUS_FRAMEDURATION;
+        std::atomic<uint32_t> _frames_per_packet_requested = 1;
+        uint32_t _frame_duration = 0;
+        uint32_t _frames_per_packet = 0;
+        std::vector<int16_t> _frame_buf;
+        size_t _frame_fill = 0;
+
+        //output
+        std::vector<uint8_t> _encoder_buf;
+        size_t _encoder_frame_max = 0;
+        uint32_t _packet_frames = 0;
+        std::vector<uint8_t> _packet_buf;
+
+        //position
+        std::mutex _position_mutex;
+        std::optional<std::array<float, 3>> _position;
 
         std::chrono::high_resolution_clock::time_point _sequence_timestemp;
         uint32_t _sequence_number = 0;
 
     private:
         static constexpr std::chrono::seconds _sequence_reset_interval = std::chrono::seconds(5);
+
+        //largest opus payload that still fits an UDP datagram: crypt(4) + header(1) + sequence(9) + length(2) + position(12)
+        static constexpr size_t _encoder_packet_max = MUMBLE_UDP_MAXLENGTH - 4 - 1 - 9 - 2 - 12;
     };
 }
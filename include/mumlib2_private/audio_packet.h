@@ -5,7 +5,9 @@
 
 //stdlib
 #include <array>
+#include <chrono>
 #include <cstdint>
+#include <optional>
 #include <vector>
 
 //mumlib
@@ -15,9 +17,18 @@ namespace mumlib2 {
 
 	class AudioPacket {
 	public:
+		AudioPacket() = default;
+
+		//validates the whole packet, never reads past length, reuses payload storage of packet
+		static AudioPacketError Parse(const uint8_t* buffer, size_t length, size_t pos, AudioPacket& packet);
+
+		//throws AudioPacketException on malformed input
 		static AudioPacket Decode(const uint8_t* buffer, size_t length, size_t pos);
-		
-		static AudioPacket CreateAudioOpusPacket(uint8_t target, int64_t sequence_number, const uint8_t* payload, size_t payload_len, bool is_last);
+
+		static const char* GetErrorString(AudioPacketError error);
+
+		static AudioPacket CreateAudioOpusPacket(uint8_t target, int64_t sequence_number, const uint8_t* payload, size_t payload_len, bool is_last,
+			const std::optional<std::array<float, 3>>& position = std::nullopt);
 		static AudioPacket CreatePingPacket(int64_t timestamp);
 
 		~AudioPacket() = default;
@@ -37,20 +48,28 @@ namespace mumlib2 {
 		int64_t GetAudioSessionId() const;
 		int64_t GetAudioSequenceNumber() const;
 		bool GetAudioLastFlag() const;
+		bool GetAudioHasPosition() const;
 		const std::array<float, 3>& GetAudioPosition() const;
 
 		int64_t GetPingTimestamp() const;
 
+		//
+		// Receive, not part of the wire format
+		//
+		void SetReceiveTime(std::chrono::system_clock::time_point time, bool kernel);
+		std::chrono::system_clock::time_point GetReceiveTime() const;
+		bool GetReceiveTimeKernel() const;
+
 	private:
-		AudioPacket() = default;
+		void clear();
 
-		void parse_header(const uint8_t* buffer, size_t length, size_t pos);
-		void parse_audio(const uint8_t* buffer, size_t length, size_t pos);
-		void parse_ping(const uint8_t* buffer, size_t length, size_t pos);
+		void parse_header(const uint8_t* buffer, size_t pos);
+		AudioPacketError parse_audio(const uint8_t* buffer, size_t length, size_t pos);
+		AudioPacketError parse_ping(const uint8_t* buffer, size_t length, size_t pos);
 
 	private:
 		//header fields
-		AudioPacketType _header_type;
+		AudioPacketType _header_type = AudioPacketType::Opus;
 		uint8_t _header_target = 0;
 
 		//audio fields
@@ -58,11 +77,16 @@ namespace mumlib2 {
 		int64_t _audio_sequencenum = 0;
 		bool _audio_last = false;
 		std::vector<uint8_t> _audio_payload;
+		bool _audio_has_position = false;
 		std::array<float, 3> _audio_position{};
 
 		//ping fields
 		int64_t _ping_timestamp = 0;
 
+		//arrival, from the kernel when _receive_kernel is set
+		std::chrono::system_clock::time_point _receive_time;
+		bool _receive_kernel = false;
+
 	private:
 		static constexpr uint8_t _header_type_mask   = 0b11100000;
 		static constexpr uint8_t _header_target_mask = 0b00011111;
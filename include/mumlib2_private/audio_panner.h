@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+#pragma once
+
+//stdlib
+#include <array>
+#include <mutex>
+#include <utility>
+
+namespace mumlib2 {
+
+    /* Stereo panner for positional voice.
+     *
+     * Uses the Mumble coordinate system (x right, y up, z forward, in meters).
+     * Gains combine constant power panning by azimuth relative to the listener
+     * heading with inverse distance attenuation. Listener is updated from user
+     * threads, gains are queried on the io thread.
+     */
+    class AudioPanner {
+    public:
+        //mark as non-copyable
+        AudioPanner(const AudioPanner&) = delete;
+        AudioPanner& operator=(const AudioPanner&) = delete;
+
+        //ctor/dtor
+        AudioPanner() = default;
+        ~AudioPanner() = default;
+
+        void SetListener(const std::array<float, 3>& position, const std::array<float, 3>& forward);
+
+        //left and right gain for a source
+        [[nodiscard]] std::pair<float, float> GetGains(const std::array<float, 3>& source);
+
+    private:
+        std::mutex _mutex;
+
+        std::array<float, 3> _position{ 0.0f, 0.0f, 0.0f };
+        std::array<float, 3> _right{ 1.0f, 0.0f, 0.0f };
+
+    private:
+        //full volume inside, then 1/distance down to the floor
+        static constexpr float _distance_min = 1.0f;
+        static constexpr float _gain_min = 0.1f;
+    };
+}
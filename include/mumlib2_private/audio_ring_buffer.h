@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+#pragma once
+
+//stdlib
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace mumlib2 {
+
+    /* Lock-free single-producer/single-consumer ring of PCM samples.
+     *
+     * Write() may run on any thread as long as only one thread writes at a time,
+     * the same applies to Read(). Samples that do not fit are rejected, never blocked on.
+     */
+    class AudioRingBuffer {
+    public:
+        //mark as non-copyable
+        AudioRingBuffer(const AudioRingBuffer&) = delete;
+        AudioRingBuffer& operator=(const AudioRingBuffer&) = delete;
+
+        //ctor/dtor, capacity is rounded up to power of two
+        explicit AudioRingBuffer(size_t capacity);
+        ~AudioRingBuffer() = default;
+
+        //producer side, returns amount of samples stored
+        size_t Write(const int16_t* data, size_t length);
+
+        //consumer side, returns amount of samples copied
+        size_t Read(int16_t* data, size_t length);
+
+        //consumer side
+        void Clear();
+
+        [[nodiscard]] size_t Available() const;
+        [[nodiscard]] size_t Capacity() const;
+
+    private:
+        std::unique_ptr<int16_t[]> _buffer;
+        size_t _mask = 0;
+
+        alignas(64) std::atomic<size_t> _head{ 0 };
+        alignas(64) std::atomic<size_t> _tail{ 0 };
+    };
+}
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+#pragma once
+
+//stdlib
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+//mumlib
+#include "mumlib2/logger.h"
+#include "mumlib2/structs.h"
+#include "mumlib2_private/audio_encoder.h"
+
+namespace mumlib2 {
+
+    /* Real-time audio send thread.
+     *
+     * Producers only push PCM into the encoder ring buffer. This thread pulls whole
+     * packets out of the encoder and hands them to the send function on an absolute
+     * schedule (next deadline = previous deadline + packet duration), so sleep jitter
+     * never accumulates into drift.
+     */
+    class AudioSender {
+    public:
+        //mark as non-copyable
+        AudioSender(const AudioSender&) = delete;
+        AudioSender& operator=(const AudioSender&) = delete;
+
+        //ctor/dtor
+        AudioSender(AudioEncoder& encoder, std::function<void(std::vector<uint8_t>&&)> send_function);
+        ~AudioSender();
+
+        void Start(const ThreadOptions& options = ThreadOptions());
+        void Stop();
+
+        [[nodiscard]] bool IsRunning() const;
+
+        void SetTarget(uint32_t target);
+
+        [[nodiscard]] uint64_t GetDeadlineMisses() const;
+
+    private:
+        void run(ThreadOptions options);
+
+    private:
+        Logger _logger = Logger("mumlib/AudioSender");
+
+        AudioEncoder& _encoder;
+        std::function<void(std::vector<uint8_t>&&)> _send_function;
+
+        std::thread _thread;
+        std::atomic<bool> _running = false;
+        std::atomic<uint32_t> _target = 0;
+        std::atomic<uint64_t> _deadline_misses = 0;
+
+    private:
+        //how often to look for new audio while waiting
+        static constexpr std::chrono::milliseconds _idle_interval = std::chrono::milliseconds(2);
+
+        //after this many packet durations without audio or behind schedule the clock is restarted
+        static constexpr uint32_t _catchup_limit = 2;
+
+        //wakeups later than this count as missed deadline
+        static constexpr std::chrono::milliseconds _deadline_tolerance = std::chrono::milliseconds(2);
+    };
+}
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+#pragma once
+
+//stdlib
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <set>
+
+//mumlib
+#include "mumlib2/structs.h"
+
+namespace mumlib2 {
+
+    /* Set of speakers whose audio should be delivered.
+     *
+     * Empty subscription means everyone is delivered. Otherwise a speaker passes
+     * if its session, its channel or the predicate matches. Modified from user
+     * threads, checked on the io thread for every audio packet.
+     */
+    class AudioSubscription {
+    public:
+        //mark as non-copyable
+        AudioSubscription(const AudioSubscription&) = delete;
+        AudioSubscription& operator=(const AudioSubscription&) = delete;
+
+        //ctor/dtor
+        AudioSubscription() = default;
+        ~AudioSubscription() = default;
+
+        void Session(int32_t session_id, bool subscribe);
+        void Channel(int32_t channel_id, bool subscribe);
+        void Predicate(std::function<bool(const MumbleUser&)> predicate);
+        void Reset();
+
+        //user is looked up lazily, only when session id alone does not decide
+        [[nodiscard]] bool Check(int32_t session_id, const std::function<std::optional<MumbleUser>(int32_t)>& user_get);
+
+    private:
+        std::mutex _mutex;
+
+        std::set<int32_t> _sessions;
+        std::set<int32_t> _channels;
+        std::function<bool(const MumbleUser&)> _predicate;
+    };
+}
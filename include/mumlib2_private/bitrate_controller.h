@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+#pragma once
+
+//stdlib
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace mumlib2 {
+
+    /* Outgoing voice bitrate controller.
+     *
+     * Keeps the total on-wire rate (Opus payload plus per-packet IP/UDP/crypt/audio
+     * header overhead) under the server bandwidth limit, and backs off on uplink
+     * loss or RTT growth reported through the control channel pings. When the
+     * budget gets tight, more frames are packed per packet so less of it is spent
+     * on headers. Fed from the io thread and from user setters, every method locks.
+     */
+    class BitrateController {
+    public:
+        //mark as non-copyable
+        BitrateController(const BitrateController&) = delete;
+        BitrateController& operator=(const BitrateController&) = delete;
+
+        //ctor/dtor
+        BitrateController(uint32_t bitrate, uint32_t frame_duration_ms, uint32_t frames_per_packet);
+        ~BitrateController() = default;
+
+        //user preference, acts as upper bound
+        void SetPreferred(uint32_t bitrate, uint32_t frame_duration_ms, uint32_t frames_per_packet);
+
+        //0 means unlimited
+        void SetServerMaxBandwidth(uint32_t max_bandwidth);
+
+        //voice tunneled through the TLS control channel
+        void SetTunnel(bool tunnel);
+
+        //every packet carries 12 bytes of position
+        void SetPositional(bool positional);
+
+        //cumulative counters of our packets as seen by the server
+        void Update(uint32_t good, uint32_t late, uint32_t lost, std::chrono::milliseconds rtt);
+
+        //drops congestion state and server limit
+        void Reset();
+
+        [[nodiscard]] uint32_t GetBitrate() const;
+        [[nodiscard]] uint32_t GetFramesPerPacket() const;
+
+        //bits per second spent on headers for given packet duration
+        [[nodiscard]] static uint32_t GetOverhead(uint32_t packet_duration_ms, bool tunnel, bool positional);
+
+    private:
+        void prefer(uint32_t bitrate, uint32_t frame_duration_ms, uint32_t frames_per_packet);
+        void fit();
+
+    private:
+        mutable std::mutex _mutex;
+
+        //preference
+        uint32_t _bitrate_preferred = 0;
+        uint32_t _frame_duration = 0;
+        uint32_t _frames_per_packet_preferred = 0;
+
+        //limits
+        uint32_t _server_max_bandwidth = 0;
+        uint32_t _congestion_budget = 0;
+        bool _tunnel = false;
+        bool _positional = false;
+
+        //measurements
+        uint32_t _last_good = 0;
+        uint32_t _last_late = 0;
+        uint32_t _last_lost = 0;
+        std::chrono::milliseconds _rtt_min = std::chrono::milliseconds::max();
+
+        //result
+        uint32_t _bitrate = 0;
+        uint32_t _frames_per_packet = 0;
+
+    private:
+        static constexpr uint32_t _bitrate_min = 8000;
+
+        //below this payload bitrate packing more frames is preferred over further quality loss
+        static constexpr uint32_t _bitrate_low = 16000;
+
+        //additive increase, multiplicative decrease
+        static constexpr uint32_t _budget_step = 4000;
+        static constexpr uint32_t _budget_backoff_num = 3;
+        static constexpr uint32_t _budget_backoff_den = 4;
+
+        //loss is only trusted over enough packets, in per mille
+        static constexpr uint32_t _loss_packets_min = 50;
+        static constexpr uint32_t _loss_congested = 50;
+        static constexpr uint32_t _loss_clear = 10;
+
+        //rtt growth above the observed minimum that counts as queueing
+        static constexpr std::chrono::milliseconds _rtt_queueing = std::chrono::milliseconds(100);
+
+        //per packet: IPv4(20) + UDP(8) + crypt(4) + audio header(1) + sequence varint(2) + length varint(2)
+        static constexpr uint32_t _overhead_udp = 20 + 8 + 4 + 1 + 2 + 2;
+
+        //per packet: IPv4(20) + TCP(20) + TLS record(5 + 16) + tunnel prefix(6) + audio header(1) + sequence varint(2) + length varint(2)
+        static constexpr uint32_t _overhead_tunnel = 20 + 20 + 5 + 16 + 6 + 1 + 2 + 2;
+
+        //x, y, z floats
+        static constexpr uint32_t _overhead_position = 12;
+    };
+}
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+#pragma once
+
+//stdlib
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace mumlib2 {
+
+    /* Bounded lock-free queue (Dmitry Vyukov's array queue).
+     *
+     * Every cell carries a sequence number that tells producers and consumers
+     * whose turn it is, so a push or pop is one compare-exchange on the shared
+     * position plus one store to the cell. Any thread may push or pop, which lets
+     * a producer evict the oldest element when the queue is full.
+     */
+    template <typename T>
+    class BoundedQueue {
+    public:
+        //mark as non-copyable
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        //capacity is rounded up to a power of two
+        explicit BoundedQueue(size_t capacity)
+        {
+            size_t size = 2;
+            while (size < capacity) {
+                size <<= 1;
+            }
+
+            _mask = size - 1;
+            _cells = std::make_unique<Cell[]>(size);
+            for (size_t i = 0; i < size; i++) {
+                _cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        ~BoundedQueue() = default;
+
+        //value is moved from only when the push succeeds
+        bool TryPush(T& value)
+        {
+            size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+            while (true) {
+                Cell& cell = _cells[pos & _mask];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+                if (diff == 0) {
+                    if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        cell.value = std::move(value);
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0) {
+                    //full
+                    return false;
+                }
+                else {
+                    pos = _enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool TryPop(T& value)
+        {
+            size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+            while (true) {
+                Cell& cell = _cells[pos & _mask];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+
+                if (diff == 0) {
+                    if (_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        value = std::move(cell.value);
+                        cell.sequence.store(pos + _mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0) {
+                    //empty
+                    return false;
+                }
+                else {
+                    pos = _dequeue_pos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        [[nodiscard]] size_t Capacity() const
+        {
+            return _mask + 1;
+        }
+
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+    private:
+        std::unique_ptr<Cell[]> _cells;
+        size_t _mask = 0;
+
+        //producers and consumers touch different cache lines
+        alignas(64) std::atomic<size_t> _enqueue_pos = 0;
+        alignas(64) std::atomic<size_t> _dequeue_pos = 0;
+    };
+}
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+#pragma once
+
+//stdlib
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//mumlib
+#include "mumlib2/constants.h"
+
+namespace mumlib2 {
+
+    /* Process-wide pool of large receive buffers.
+     *
+     * Control messages are small, so every Transport keeps only a small inline
+     * buffer and borrows a slab from here for the rare large message (comments,
+     * textures, big channel descriptions). Slabs are bucketed by size and only a
+     * few free slabs per bucket are retained, everything else goes back to the heap.
+     */
+    class BufferPool {
+    public:
+        class Buffer {
+        public:
+            Buffer() = default;
+            Buffer(Buffer&& other) noexcept;
+            Buffer& operator=(Buffer&& other) noexcept;
+            ~Buffer();
+
+            //mark as non-copyable
+            Buffer(const Buffer&) = delete;
+            Buffer& operator=(const Buffer&) = delete;
+
+            [[nodiscard]] uint8_t* Data() const;
+            [[nodiscard]] size_t Size() const;
+
+            void Release();
+
+        private:
+            friend class BufferPool;
+            Buffer(BufferPool* pool, std::unique_ptr<uint8_t[]> data, size_t slab);
+
+        private:
+            BufferPool* _pool = nullptr;
+            std::unique_ptr<uint8_t[]> _data;
+            size_t _slab = 0;
+        };
+
+    public:
+        //mark as non-copyable
+        BufferPool(const BufferPool&) = delete;
+        BufferPool& operator=(const BufferPool&) = delete;
+
+        static BufferPool& Instance();
+
+        //returns empty buffer if length exceeds the largest slab
+        Buffer Acquire(size_t length);
+
+    private:
+        BufferPool() = default;
+
+        void release(std::unique_ptr<uint8_t[]> data, size_t slab);
+
+    private:
+        std::mutex _mutex;
+        std::array<std::vector<std::unique_ptr<uint8_t[]>>, 3> _free;
+
+    private:
+        static constexpr std::array<size_t, 3> _slab_sizes = { 8 * 1024, 32 * 1024, MUMBLE_TCP_MAXLENGTH };
+        static constexpr size_t _slab_retain = 4;
+    };
+}
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+#pragma once
+
+//stdlib
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+//mumlib
+#include "mumlib2/callback.h"
+#include "mumlib2/structs.h"
+#include "mumlib2_private/bounded_queue.h"
+
+namespace mumlib2 {
+
+    enum class DispatchClass {
+        AUDIO,
+        STATE,
+        CONTROL
+    };
+
+    /* Queued delivery of Callback events.
+     *
+     * The io thread pushes events, one or more user threads deliver them with
+     * Pump(). Audio has its own queue so evicting old audio never touches control
+     * events. State events are coalesced by key: only a marker goes into the queue,
+     * the latest event of the key waits in a map until the marker is delivered.
+     */
+    class CallbackDispatcher {
+    public:
+        using Function = std::function<void(Callback&)>;
+
+        //mark as non-copyable
+        CallbackDispatcher(const CallbackDispatcher&) = delete;
+        CallbackDispatcher& operator=(const CallbackDispatcher&) = delete;
+
+        //ctor/dtor
+        CallbackDispatcher(Callback& callback, DispatchOptions options);
+        ~CallbackDispatcher();
+
+        [[nodiscard]] static bool Validate(const DispatchOptions& options);
+
+        //key only matters for coalesced state events, name is the callback it invokes, a string literal
+        void Push(DispatchClass type, uint64_t key, const char* name, Function function);
+
+        //control and state events go first, returns events delivered
+        size_t Pump(std::chrono::milliseconds wait, size_t max_events);
+
+        //false releases producers waiting on a full queue and makes BLOCK drop instead,
+        //needed while the consumer waits for the io thread
+        void SetBlocking(bool blocking);
+
+        void GetStatistics(Statistics& statistics) const;
+
+    private:
+        struct Event {
+            Function function;
+            const char* name = nullptr;
+            uint64_t key = 0;
+            bool coalesced = false;
+        };
+
+        bool push(BoundedQueue<Event>& queue, Event& event, DispatchPolicy policy);
+        void deliver(Event& event);
+
+    private:
+        Callback& _callback;
+        DispatchOptions _options;
+
+        BoundedQueue<Event> _events;
+        BoundedQueue<Event> _audio;
+
+        std::mutex _coalesce_mutex;
+        std::unordered_map<uint64_t, Function> _coalesce;
+
+        std::atomic<bool> _blocking = true;
+        std::atomic<bool> _waiting = false;
+        std::mutex _wait_mutex;
+        std::condition_variable _wait_condition;
+
+        //metrics, depth may dip below zero while a push is being counted
+        std::atomic<int64_t> _depth = 0;
+        std::atomic<int64_t> _depth_max = 0;
+        std::atomic<uint64_t> _dropped = 0;
+        std::atomic<uint64_t> _coalesced = 0;
+
+    private:
+        //how long a blocked producer sleeps before retrying
+        static constexpr std::chrono::microseconds _block_interval = std::chrono::microseconds(100);
+    };
+}
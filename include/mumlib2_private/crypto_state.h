@@ -39,14 +39,30 @@ namespace mumlib2 {
 
         bool isValid() const;
 
+        //forget key and counters, until the next setKey()
+        void reset();
+
         void genKey();
 
         void setKey(const unsigned char *rkey, const unsigned char *eiv, const unsigned char *div);
 
+        //server nonce from a resync, counted in getResync()
         void setDecryptIV(const unsigned char *iv);
 
         const unsigned char* getEncryptIV() const;
 
+        //packets received by us
+        unsigned int getGood() const;
+        unsigned int getLate() const;
+        unsigned int getLost() const;
+        unsigned int getResync() const;
+
+        //packets received by the other side, as reported through ping
+        void setRemoteStats(unsigned int good, unsigned int late, unsigned int lost, unsigned int resync);
+        unsigned int getRemoteGood() const;
+        unsigned int getRemoteLate() const;
+        unsigned int getRemoteLost() const;
+
         void ocb_encrypt(const unsigned char *plain, unsigned char *encrypted, unsigned int len,
                          const unsigned char *nonce,
                          unsigned char *tag);
@@ -4,19 +4,36 @@
 #pragma once
 
 //stdlib
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 //mumlib
+#include "mumlib2/audio_frame.h"
 #include "mumlib2/callback.h"
 #include "mumlib2/constants.h"
 #include "mumlib2/structs.h"
+#include "mumlib2/tls_context.h"
+#include "mumlib2_private/audio_arrival.h"
 #include "mumlib2_private/audio_decoder.h"
 #include "mumlib2_private/audio_encoder.h"
+#include "mumlib2_private/audio_panner.h"
+#include "mumlib2_private/audio_sender.h"
+#include "mumlib2_private/audio_subscription.h"
+#include "mumlib2_private/bitrate_controller.h"
+#include "mumlib2_private/callback_dispatcher.h"
+#include "mumlib2_private/thread_scheduler.h"
+#include "mumlib2_private/tracer.h"
 #include "mumlib2_private/transport.h"
 #include "mumble.pb.h"
 
@@ -28,10 +45,29 @@ namespace mumlib2 {
         Mumlib2Private& operator=(const Mumlib2Private&) = delete;
 
         Mumlib2Private(Callback& callback);
+        ~Mumlib2Private();
 
         //Audio
         void AudioSend(const int16_t* pcmData, int pcmLength);
         void AudioSendTarget(const int16_t* pcmData, int pcmLength, uint32_t target);
+        void AudioSendEnd(uint32_t target);
+        bool AudioSendEncoded(uint32_t target, int64_t sequence_number, const uint8_t* payload, size_t payload_len, bool is_last);
+        bool AudioSetBitrate(uint32_t bitrate);
+        bool AudioSetEncoderProfile(const AudioEncoderProfile& profile);
+        void AudioSetFrameAllocator(std::shared_ptr<AudioFrameAllocator> allocator);
+        bool AudioSetFrameDuration(uint32_t frame_duration_ms, uint32_t frames_per_packet);
+        void AudioSetPassthrough(bool enabled);
+        bool AudioSetPanning(bool enabled);
+        void AudioSetListener(const std::array<float, 3>& position, const std::array<float, 3>& forward);
+        void AudioSetPosition(const std::optional<std::array<float, 3>>& position);
+        bool AudioSetOutputFormat(AudioSampleFormat format, uint32_t channels);
+        bool AudioSetInputSamplerate(uint32_t samplerate, ResamplerQuality quality);
+        bool AudioSetOutputSamplerate(uint32_t samplerate, ResamplerQuality quality);
+        bool AudioSetSendThread(bool enabled, const ThreadOptions& options);
+        void AudioSubscribeSession(int32_t session_id, bool subscribe);
+        void AudioSubscribeChannel(int32_t channel_id, bool subscribe);
+        void AudioSubscribePredicate(std::function<bool(const MumbleUser&)> predicate);
+        void AudioSubscribeReset();
 
         // ACL
         bool AclSetTokens(const std::vector<std::string>& tokens);
@@ -43,6 +79,14 @@ namespace mumlib2 {
         [[nodiscard]] int32_t ChannelFind(const std::string& channel_name) const;
         bool ChannelJoin(uint32_t channel_id);
 
+        //Dispatch
+        bool DispatchSetOptions(const DispatchOptions& options);
+        size_t DispatchPump(std::chrono::milliseconds wait, size_t max_events);
+
+        //Statistics
+        [[nodiscard]] Statistics StatisticsGet();
+        [[nodiscard]] std::vector<SpeakerStatistics> StatisticsGetSpeakers();
+
         //Text
         bool TextSend(const std::string& message);
 
@@ -50,9 +94,14 @@ namespace mumlib2 {
         bool TransportConnect(const std::string& host, uint16_t port, const std::string& user, const std::string& password);
         void TransportDisconnect();
         [[nodiscard]] ConnectionState TransportGetState() const;
+        [[nodiscard]] std::error_code TransportGetError();
+        void TransportSetReconnect(bool enabled, uint32_t delay_min_ms, uint32_t delay_max_ms);
+        bool TransportSetOptions(const TransportOptions& options);
         void TransportRun();
+        bool TransportRunThread(const ThreadOptions& options);
         void TransportSetCert(const std::string& cert);
         void TransportSetKey(const std::string& key);
+        void TransportSetTlsContext(std::shared_ptr<TlsContext> context);
 
         //User
         [[nodiscard]] std::optional<MumbleUser> UserGet(int32_t session_id);
@@ -75,8 +124,40 @@ namespace mumlib2 {
         void generalClear();
 
         // Audio
-        void audioDecoderCreate(uint32_t output_samplerate);
-        void audioEncoderCreate(uint32_t input_samplerate, uint32_t output_bitrate);
+        void audioDecoderCreate();
+        std::shared_ptr<AudioDecoder> audioDecoderGet();
+        void audioEncoderCreate(uint32_t input_samplerate, uint32_t output_bitrate, ResamplerQuality quality, const AudioEncoderProfile& profile);
+        void audioSenderCreate();
+        void audioBitrateApply();
+        bool audioFrameDeliver(AudioPacket& packet, AudioDecoder& decoder);
+
+        // Dispatch
+        //state events that replace earlier ones of the same kind and id
+        enum class DispatchKey : uint64_t {
+            CODEC_VERSION = 1,
+            PERMISSION_QUERY,
+            SERVER_CONFIG,
+            UDP_STATE,
+            USER_STATS
+        };
+
+        static constexpr uint64_t dispatchKey(DispatchKey kind, uint32_t id)
+        {
+            return static_cast<uint64_t>(kind) << 32 | id;
+        }
+
+        //calls back right away, or queues the call when dispatch is queued
+        template <typename Function>
+        void dispatch(DispatchClass type, uint64_t key, const char* name, Function&& function)
+        {
+            if (_dispatcher) {
+                _dispatcher->Push(type, key, name, std::forward<Function>(function));
+            }
+            else {
+                MUMLIB2_TRACE_SCOPE(name, USER_CALLBACK);
+                function(_callback);
+            }
+        }
 
         // Channel
         void channelEmplace(MumbleChannel& channel);
@@ -95,9 +176,13 @@ namespace mumlib2 {
         bool processControlVersionPacket(const uint8_t* buffer, int length);
         bool processControlUserRemovePacket(const uint8_t* buffer, int length);
         bool processControlUserStatePacket(const uint8_t* buffer, int length);
+        bool processControlPingPacket(const uint8_t* buffer, int length);
         bool processControlServerconfigPacket(const uint8_t* buffer, int length);
         bool processControlServersyncPacket(const uint8_t* buffer, int length);
         bool processAudioPacket(AudioPacket& packet);
+        void processTransportError(const std::error_code& error);
+        void processTransportState(ConnectionState state);
+        void processTransportUdpState(bool active);
 
         // User
         void userClear();
@@ -106,36 +191,91 @@ namespace mumlib2 {
 
         //Session
         [[nodiscard]] uint32_t sessionGet() const;
+        void sessionRestore();
 
         //Transport
         void transportCreate();
+        void transportRelease();
+        void transportThreadJoin();
         bool transportSendAuthentication(const std::vector<std::string>& tokens);
         bool transportSendControl(MessageType type, google::protobuf::Message& message);
-        bool transportSendAudio(const uint8_t* data, size_t len);
+        bool transportSendAudio(std::vector<uint8_t>&& packet);
+
+        //Voicetarget
+        bool voicetargetSend(int targetId);
+
+    private:
+        struct VoicetargetEntry {
+            VoiceTargetType type;
+            int32_t id;
+
+            //user targets are resolved by name again after reconnect
+            std::string user_name;
+        };
 
     private:
         //Audio
-        std::unique_ptr<AudioDecoder> _audio_decoder;
+        AudioArrival _audio_arrival;
+        std::shared_ptr<AudioDecoder> _audio_decoder;
+        std::mutex _audio_decoder_mutex;
         std::unique_ptr<AudioEncoder> _audio_encoder;
+        std::unique_ptr<AudioSender> _audio_sender;
+        std::mutex _audio_encoder_mutex;
+        bool _audio_send_thread = false;
+        ThreadOptions _audio_send_thread_options;
+        std::atomic<bool> _audio_passthrough = false;
+        AudioSubscription _audio_subscription;
+        AudioPanner _audio_panner;
+        bool _audio_panning = false;
+        std::optional<std::array<float, 3>> _audio_position;
+        std::shared_ptr<AudioFrameAllocator> _audio_frame_allocator;
+        std::mutex _audio_frame_allocator_mutex;
         uint32_t _audio_bitrate = MUMBLE_OPUS_BITRATE;
+        BitrateController _audio_bitrate_controller = BitrateController(MUMBLE_OPUS_BITRATE, MUMBLE_OPUS_FRAMEDURATION, 1);
+        AudioEncoderProfile _audio_encoder_profile;
+        uint32_t _audio_frame_duration = MUMBLE_OPUS_FRAMEDURATION;
+        uint32_t _audio_frames_per_packet = 1;
+        uint32_t _audio_input_samplerate = MUMBLE_AUDIO_SAMPLERATE;
+        uint32_t _audio_output_samplerate = MUMBLE_AUDIO_SAMPLERATE;
+        ResamplerQuality _audio_input_quality = MUMBLE_RESAMPLER_QUALITY;
+        ResamplerQuality _audio_output_quality = MUMBLE_RESAMPLER_QUALITY;
+        AudioSampleFormat _audio_output_format = AudioSampleFormat::INT16;
+        uint32_t _audio_output_channels = MUMBLE_AUDIO_CHANNELS;
+
+        //ACL
+        std::vector<std::string> _acl_tokens;
 
         //Callback
         Callback& _callback;
 
+        //Dispatch
+        std::unique_ptr<CallbackDispatcher> _dispatcher;
+
         //Channel
         std::vector<MumbleChannel> _channel_list;
         uint32_t _channel_current = 0;
+        std::optional<uint32_t> _channel_restore;
 
         //Logger
         Logger _logger = Logger("");
 
         //Transport
         std::unique_ptr<Transport> _transport;
+        std::mutex _transport_mutex;
+        std::thread _transport_thread;
+        std::mutex _transport_run_mutex;
+        std::atomic<bool> _transport_release = false;
         std::string _transport_cert;
         std::string _transport_key;
+        std::shared_ptr<TlsContext> _transport_tls_context;
+        bool _transport_reconnect = false;
+        uint32_t _transport_reconnect_min = MUMBLE_RECONNECT_DELAY_MIN_MS;
+        uint32_t _transport_reconnect_max = MUMBLE_RECONNECT_DELAY_MAX_MS;
+        TransportOptions _transport_options;
 
         //User
         std::map<int32_t, MumbleUser> _user_map; //{session_id, MumbleUser}
+        std::set<std::string> _user_muted_names;
 
         //Session
         uint32_t _session_id = 0;
@@ -148,7 +288,7 @@ namespace mumlib2 {
         std::string _server_welcometext;
 
         //Voicetarget
-        MumbleProto::VoiceTarget _voiceTarget;
+        std::map<int, std::vector<VoicetargetEntry>> _voicetargets;
 
     private:
         //audio
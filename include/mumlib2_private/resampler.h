@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+#pragma once
+
+//stdlib
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//mumlib
+#include "mumlib2/enums.h"
+
+namespace mumlib2 {
+
+    /* Polyphase windowed-sinc resampler for interleaved PCM.
+     *
+     * The conversion ratio is reduced to L/M and one FIR phase is precomputed for
+     * each of the L sub-sample offsets, so every output sample is a single dot
+     * product over contiguous memory. Ratios with more than 256 offsets, like
+     * 44100 to 44101 Hz, keep 256 phases and blend the two nearest ones instead.
+     * State is kept between calls, input may be fed in blocks of any size. History
+     * lives in rings sized at construction, blocks of up to 120 ms never allocate.
+     */
+    class Resampler {
+    public:
+        //mark as non-copyable
+        Resampler(const Resampler&) = delete;
+        Resampler& operator=(const Resampler&) = delete;
+
+        //ctor/dtor
+        Resampler(uint32_t input_samplerate, uint32_t output_samplerate, uint32_t channels, ResamplerQuality quality);
+        ~Resampler() = default;
+
+        [[nodiscard]] bool IsPassthrough() const;
+
+        //upper bound of output frames produced for given amount of input frames
+        [[nodiscard]] size_t GetOutputLength(size_t input_frames) const;
+
+        //returns amount of frames written to output
+        size_t Process(const int16_t* input, size_t input_frames, int16_t* output, size_t output_frames);
+        size_t Process(const float* input, size_t input_frames, float* output, size_t output_frames);
+
+        void Reset();
+
+    private:
+        void createFilter(ResamplerQuality quality);
+        template <typename T>
+        size_t process(const T* input, size_t input_frames, T* output, size_t output_frames);
+
+        float* historyChannel(uint32_t channel);
+        void historyResize(size_t capacity);
+
+        static float dot(const float* a, const float* b, size_t length);
+
+    private:
+        uint32_t _channels = 0;
+        uint32_t _interpolation = 1;
+        uint32_t _decimation = 1;
+        uint32_t _phases = 1;
+
+        size_t _taps = 0;
+        std::vector<float> _filter;
+
+        //per channel 2 * _history_capacity samples, each stored twice so a filter window is always contiguous
+        std::vector<float> _history;
+        size_t _history_capacity = 0;
+        size_t _history_start = 0;
+        size_t _history_fill = 0;
+        size_t _index = 0;
+        uint32_t _phase = 0;
+
+    private:
+        //bounds filter size and setup time for near-coprime rates
+        static constexpr uint32_t _phases_max = 256;
+    };
+}
@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+#pragma once
+
+//mumlib
+#include "mumlib2/logger.h"
+#include "mumlib2/structs.h"
+
+namespace mumlib2 {
+
+    /* Scheduling setup for threads owned by the library.
+     *
+     * Options are applied by the thread to itself right after it starts. Linux
+     * only, elsewhere the request is logged and ignored. A setting the process
+     * has no permission for is logged and the thread runs with what it has.
+     */
+    class ThreadScheduler {
+    public:
+        [[nodiscard]] static bool Validate(const ThreadOptions& options);
+
+        //applies to the calling thread, memory locking to the whole process
+        static void Apply(const ThreadOptions& options, Logger& logger);
+    };
+}
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+#pragma once
+
+//stdlib
+#include <map>
+#include <mutex>
+#include <string>
+
+//boost
+#include <asio.hpp>
+#include <asio/ssl.hpp>
+
+namespace mumlib2 {
+
+    /* Shared part of TlsContext.
+     *
+     * SSL_CTX is only read after setup, OpenSSL allows that from any thread. The
+     * session cache is guarded by its own mutex.
+     */
+    class TlsContextPrivate {
+    public:
+        //mark as non-copyable
+        TlsContextPrivate(const TlsContextPrivate&) = delete;
+        TlsContextPrivate& operator=(const TlsContextPrivate&) = delete;
+
+        TlsContextPrivate();
+        ~TlsContextPrivate();
+
+        asio::ssl::context& GetContext();
+
+        //returns a new reference to be freed by the caller, nullptr when nothing is cached
+        SSL_SESSION* SessionGet(const std::string& key);
+
+        //takes over the reference, replaces the previous session of key
+        void SessionPut(const std::string& key, SSL_SESSION* session);
+
+        size_t SessionCount();
+        void SessionClear();
+
+    private:
+        asio::ssl::context _context;
+
+        std::mutex _sessions_mutex;
+        std::map<std::string, SSL_SESSION*> _sessions;
+    };
+}
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+#pragma once
+
+//stdlib
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//mumlib
+#include "mumlib2/logger.h"
+
+namespace mumlib2 {
+
+    enum class TraceCategory : uint8_t {
+        TRANSPORT,
+        CRYPT,
+        PACKET,
+        DECODER,
+        CONTROL,
+        USER_CALLBACK
+    };
+
+    /* Process-wide span recorder.
+     *
+     * Spans go into a fixed ring without locking, the oldest are overwritten once
+     * it is full. Every slot carries a sequence number that is cleared while the
+     * slot is written, so Export() can run next to recording threads and skips
+     * slots it catches mid-write. Names must be string literals, only the pointer
+     * is stored.
+     */
+    class Tracer {
+    public:
+        //mark as non-copyable
+        Tracer(const Tracer&) = delete;
+        Tracer& operator=(const Tracer&) = delete;
+
+        static Tracer& Instance();
+
+        //capacity is rounded up to a power of two, callbacks running for slow_callback or longer are reported
+        bool Start(size_t capacity, std::chrono::microseconds slow_callback);
+        void Stop();
+
+        //writes recorded spans in Chrome trace event format, loads in Perfetto and chrome://tracing
+        bool Export(const std::string& path) const;
+
+        [[nodiscard]] bool IsEnabled() const
+        {
+            return _buffer.load(std::memory_order_relaxed) != nullptr;
+        }
+
+        [[nodiscard]] uint64_t GetSlowCallbacks() const;
+
+        void Record(const char* name, TraceCategory category, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+    private:
+        struct Span {
+            std::atomic<uint64_t> sequence = 0;
+            std::atomic<const char*> name = nullptr;
+            std::atomic<uint8_t> category = 0;
+            std::atomic<bool> slow = false;
+            std::atomic<uint32_t> thread = 0;
+            std::atomic<int64_t> start_ns = 0;
+            std::atomic<int64_t> duration_ns = 0;
+        };
+
+        struct Buffer {
+            explicit Buffer(size_t capacity);
+
+            std::unique_ptr<Span[]> spans;
+            size_t mask = 0;
+            std::atomic<uint64_t> next = 0;
+        };
+
+        Tracer() = default;
+
+        static uint32_t threadId();
+
+    private:
+        //buffers of earlier sessions stay alive, a recording thread may still hold them
+        mutable std::mutex _mutex;
+        std::vector<std::unique_ptr<Buffer>> _buffers;
+        std::atomic<Buffer*> _buffer = nullptr;
+
+        //spans of the current session start here
+        std::atomic<uint64_t> _baseline = 0;
+
+        std::chrono::steady_clock::time_point _epoch = std::chrono::steady_clock::now();
+        std::atomic<int64_t> _slow_callback_ns = 0;
+        std::atomic<uint64_t> _slow_callbacks = 0;
+
+        Logger _logger = Logger("mumlib/Tracer");
+    };
+
+    /* Records the enclosing scope as a span when tracing is running.
+     */
+    class TraceScope {
+    public:
+        //mark as non-copyable
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+
+        TraceScope(const char* name, TraceCategory category) : _name(name), _category(category)
+        {
+            if (Tracer::Instance().IsEnabled()) {
+                _start = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~TraceScope()
+        {
+            if (_start != std::chrono::steady_clock::time_point() && Tracer::Instance().IsEnabled()) {
+                Tracer::Instance().Record(_name, _category, _start, std::chrono::steady_clock::now());
+            }
+        }
+
+    private:
+        const char* _name;
+        TraceCategory _category;
+        std::chrono::steady_clock::time_point _start;
+    };
+}
+
+//trace points compile to nothing unless the library is built with MUMLIB2_ENABLE_TRACING
+#if defined(MUMLIB2_TRACING)
+#define MUMLIB2_TRACE_CONCAT_INNER(a, b) a##b
+#define MUMLIB2_TRACE_CONCAT(a, b) MUMLIB2_TRACE_CONCAT_INNER(a, b)
+#define MUMLIB2_TRACE_SCOPE(name, category) ::mumlib2::TraceScope MUMLIB2_TRACE_CONCAT(trace_scope_, __LINE__)(name, ::mumlib2::TraceCategory::category)
+#else
+#define MUMLIB2_TRACE_SCOPE(name, category)
+#endif
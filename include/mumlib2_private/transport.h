@@ -5,11 +5,15 @@
 
 //stdlib
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <functional>
+#include <memory>
 #include <optional>
+#include <random>
 #include <string>
 #include <system_error>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -24,9 +28,12 @@
 #include "mumlib2/constants.h"
 #include "mumlib2/enums.h"
 #include "mumlib2/logger.h"
+#include "mumlib2/structs.h"
+#include "mumlib2/tls_context.h"
+#include "mumlib2/transport_error.h"
 #include "mumlib2_private/audio_packet.h"
+#include "mumlib2_private/buffer_pool.h"
 #include "mumlib2_private/crypto_state.h"
-#include "mumlib2_private/transport_ssl_context.h"
 #include "mumlib2_private/varint.h"
 
 
@@ -34,11 +41,16 @@ namespace mumlib2 {
 
     class Transport {
     public:
+        //largest voice packet both paths carry, UDP spends 4 bytes of the datagram on the crypt header
+        static constexpr uint32_t AUDIO_PACKET_MAX = MUMBLE_UDP_MAXLENGTH - 4;
+
         Transport(
                   std::function<bool(MessageType, uint8_t*, int)> processControlMessageFunc,
                   std::function<bool(AudioPacket&)>                processEncodedAudioPacketFunction,
-                  std::string cert_file = "",
-                  std::string privkey_file = "");
+                  std::function<void(const std::error_code&)>      processErrorFunction,
+                  std::function<void(ConnectionState)>             processStateFunction,
+                  std::function<void(bool)>                        processUdpStateFunction,
+                  std::shared_ptr<TlsContext>                      tlsContext);
 
         ~Transport();
 
@@ -47,20 +59,62 @@ namespace mumlib2 {
 
         void connect(const std::string& host, int port, const std::string& user, const std::string& password);
 
+        //thread-safe, posted to the io thread while run() is active on another thread
         void disconnect();
 
+        //reconnect with exponential backoff when an established or attempted connection fails,
+        //call before connect()
+        void setReconnect(bool enabled, std::chrono::milliseconds delay_min, std::chrono::milliseconds delay_max);
+
+        //applied to sockets opened after the call
+        void setOptions(const TransportOptions& transportOptions) {
+            options = transportOptions;
+        }
+
+        //sent with every authentication, call before connect()
+        void setAuthTokens(std::vector<std::string> tokens) {
+            authTokens = std::move(tokens);
+        }
+
         ConnectionState getConnectionState() {
             return state;
         }
 
         bool isUdpActive();
 
+        //error that closed the connection, empty while connected or after a clean disconnect
+        std::error_code getLastError() const {
+            return lastError;
+        }
+
+        //round trip time of the last control channel ping
+        std::chrono::milliseconds getPingRtt() const {
+            return pingRtt;
+        }
+
+        const CryptState& getCryptState() const {
+            return cryptState;
+        }
+
+        //thread-safe
+        void getStatistics(Statistics& statistics) const;
+
         void sendControlMessage(MessageType type, google::protobuf::Message &message);
 
         void sendEncodedAudioPacket(const uint8_t *buffer, int length);
 
+        //thread-safe, packet is sent from the io thread
+        void postEncodedAudioPacket(std::vector<uint8_t>&& packet);
+
         void run(){
+            runThread = std::this_thread::get_id();
             ioService.run();
+            runThread = std::thread::id();
+        }
+
+        //true on the thread inside run(), callbacks are invoked there
+        bool isIoThread() const {
+            return runThread.load() == std::this_thread::get_id();
         }
 
         void sendAuthentication(std::optional<const std::vector<std::string>> tokens);
@@ -69,6 +123,7 @@ namespace mumlib2 {
         Logger logger;
 
         asio::io_service ioService;
+        std::atomic<std::thread::id> runThread;
 
         std::pair<std::string, int> connectionParams;
 
@@ -78,7 +133,15 @@ namespace mumlib2 {
 
         std::function<bool(AudioPacket&)> processEncodedAudioPacketFunction;
 
-        volatile bool udpActive;
+        std::function<void(const std::error_code&)> processErrorFunction;
+
+        std::function<void(ConnectionState)> processStateFunction;
+
+        std::function<void(bool)> processUdpStateFunction;
+
+        std::error_code lastError;
+
+        std::atomic<bool> udpActive = false;
 
         ConnectionState state = ConnectionState::NOT_CONNECTED;
         PingState ping_state = PingState::NONE;
@@ -86,25 +149,118 @@ namespace mumlib2 {
         asio::ip::udp::socket udpSocket;
         asio::ip::udp::endpoint udpReceiverEndpoint;
         uint8_t udpIncomingBuffer[MUMBLE_UDP_MAXLENGTH];
+        bool udpReceiving = false;
+        bool udpTimestamps = false;
+        uint32_t udpDecryptFailures = 0;
+        std::chrono::steady_clock::time_point cryptResyncRequested;
         CryptState cryptState;
 
-        asio::ssl::context sslContext;
-        SslContextHelper sslContextHelper;
-        asio::ssl::stream<asio::ip::tcp::socket> sslSocket;
-        std::array<uint8_t, MUMBLE_TCP_MAXLENGTH> sslIncomingBuffer;
+        //parsed in place, reused for every incoming voice packet
+        AudioPacket audioIncomingPacket;
+        std::atomic<uint64_t> audioPacketsReceived{0};
+        std::atomic<uint64_t> audioPacketsMalformed{0};
+        std::atomic<uint64_t> audioPacketsUndecodable{0};
+        std::atomic<uint64_t> udpPacketsDecryptFailed{0};
+        std::atomic<uint64_t> udpPacketsDropped{0};
+        std::atomic<uint64_t> udpFallbacks{0};
+        std::atomic<uint64_t> udpRecoveries{0};
+        std::atomic<uint64_t> udpPingsSent{0};
+        std::atomic<uint64_t> udpPingsReceived{0};
+        std::atomic<uint32_t> udpPingRttMs{0};
+        std::atomic<uint32_t> tcpPingRttMs{0};
+        std::atomic<uint64_t> reconnects{0};
+        std::atomic<uint64_t> tlsSessionsResumed{0};
+        std::atomic<uint32_t> timeToServerSyncMs{0};
+        std::atomic<uint64_t> udpKernelDrops{0};
+        uint64_t udpKernelDropsBase = 0;
+        std::atomic<uint64_t> ioDeadlineMisses{0};
+        std::atomic<uint64_t> cryptResyncRequests{0};
+        std::atomic<uint64_t> cryptResyncs{0};
+        std::atomic<uint32_t> ioLatenessMaxUs{0};
+        std::atomic<uint32_t> udpReceiveDelayUs{0};
+        std::atomic<uint32_t> udpReceiveDelayMaxUs{0};
+
+        TransportOptions options;
+
+        //happy eyeballs, attempts race and the first connected socket becomes the TLS transport
+        asio::ip::tcp::resolver resolver;
+        std::vector<asio::ip::tcp::endpoint> connectEndpoints;
+        std::vector<std::unique_ptr<asio::ip::tcp::socket>> connectAttempts;
+        size_t connectAttemptsPending = 0;
+        asio::steady_timer connectAttemptTimer;
+        uint32_t connectGeneration = 0;
+        std::chrono::steady_clock::time_point connectStarted;
+
+        std::shared_ptr<TlsContext> tlsContext;
+        std::unique_ptr<asio::ssl::stream<asio::ip::tcp::socket>> sslSocket;
+        std::vector<std::string> authTokens;
+        std::array<uint8_t, 6> sslIncomingHeader;
+        std::array<uint8_t, 2048> sslIncomingInline;
+        BufferPool::Buffer sslIncomingLarge;
 
 
         asio::steady_timer pingTimer;
-        std::chrono::time_point<std::chrono::system_clock> lastReceivedUdpPacketTimestamp;
+        std::chrono::milliseconds pingRtt{0};
+
+        asio::steady_timer udpPingTimer;
+        uint32_t udpPingsUnanswered = 0;
+
+        asio::steady_timer reconnectTimer;
+        bool reconnectEnabled = false;
+        std::chrono::milliseconds reconnectDelayMin{MUMBLE_RECONNECT_DELAY_MIN_MS};
+        std::chrono::milliseconds reconnectDelayMax{MUMBLE_RECONNECT_DELAY_MAX_MS};
+        uint32_t reconnectAttempt = 0;
+        std::mt19937 reconnectRandom;
 
         void pingTimerTick(const std::error_code &e);
 
+        void udpPingTimerTick(const std::error_code &e);
+
+        //switches the voice path and reports the transition
+        void setUdpActive(bool active, const char* reason);
+
+        void processUdpPing(uint64_t timestamp);
+
+        //asks the server for its nonce, rate limited
+        void requestCryptResync();
+
+        //starts the lookup for a fresh TLS stream, everything after it runs on the io thread
+        void startConnect();
+
+        void resolveHandler(uint32_t generation, const std::error_code& error, const asio::ip::tcp::resolver::results_type& results);
+
+        void startConnectAttempt(uint32_t generation);
+
+        void connectAttemptHandler(uint32_t generation, size_t index, const std::error_code& error);
+
+        void scheduleReconnect();
+
+        void closeSockets();
+
+        void disconnectPrivate();
+
+        //failures are logged, the connection works with the system defaults
+        template <typename Socket>
+        void applySocketOptions(Socket& socket, bool v6, bool udp);
+
+        //reads the kernel drop counter of the UDP socket
+        void updateKernelDrops();
+
+        void saveSslSession();
+
+        //sessions are cached per server in the shared context
+        std::string sessionKey() const;
+
+        void setState(ConnectionState newState);
+
         void sslConnectHandler(const std::error_code &error);
 
         void sslHandshakeHandler(const std::error_code &error);
 
         void doReceiveSsl();
 
+        void doReceiveSslPayload(MessageType messageType, size_t payloadLength);
+
         void sendSsl(uint8_t *buff, int length);
 
         void sendSslAsync(uint8_t *buff, int length);
@@ -117,12 +273,27 @@ namespace mumlib2 {
 
         void processMessageInternal(MessageType messageType, uint8_t *buffer, int length);
 
+        //arrival is taken by the kernel when kernel is set, otherwise when the io thread got to the packet
+        void processAudioPacketInternal(const uint8_t *buffer, size_t length, bool udp, std::chrono::system_clock::time_point arrival, bool kernel);
+
         void doReceiveUdp();
 
+        //recvmsg() based receive that picks up the SO_TIMESTAMPNS ancillary data, Linux only
+        void doReceiveUdpTimestamped();
+
+        void processUdpDatagram(size_t bytesTransferred, std::chrono::system_clock::time_point arrival, bool kernel);
+
+        void handleUdpReceiveError(const std::error_code& ec);
+
         void sendUdpAsync(const uint8_t *buff, int length);
 
         void sendUdpPing();
 
+        //applies the policy of the error, never throws
+        void handleError(TransportError error, const std::string& detail = "");
+
+        void handleSslReceiveError(const std::error_code& ec);
+
         void throwTransportException(std::string message);
     };
 
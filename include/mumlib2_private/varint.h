@@ -4,28 +4,231 @@
 #pragma once
 
 //stdlib
+#include <array>
+#include <concepts>
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
+//mumlib
+#include "mumlib2/exceptions.h"
+
 namespace mumlib2 {
 
+    namespace varint_detail {
+
+        //encoded size and value bits of every leading byte
+        struct Lead {
+            uint8_t size;
+            uint8_t mask;
+        };
+
+        constexpr std::array<Lead, 256> makeTable()
+        {
+            std::array<Lead, 256> table{};
+            for (size_t i = 0; i < table.size(); i++) {
+                if (i < 0x80) {
+                    table[i] = { 1, 0x7F };
+                }
+                else if (i < 0xC0) {
+                    table[i] = { 2, 0x3F };
+                }
+                else if (i < 0xE0) {
+                    table[i] = { 3, 0x1F };
+                }
+                else if (i < 0xF0) {
+                    table[i] = { 4, 0x0F };
+                }
+                else if (i < 0xF4) {
+                    table[i] = { 5, 0x00 };
+                }
+                else if (i < 0xF8) {
+                    table[i] = { 9, 0x00 };
+                }
+                else if (i < 0xFC) {
+                    //negative recursive, unwrapped before the lookup
+                    table[i] = { 1, 0x00 };
+                }
+                else {
+                    table[i] = { 1, 0x03 };
+                }
+            }
+            return table;
+        }
+
+        inline constexpr std::array<Lead, 256> lead_table = makeTable();
+    }
+
+    /* Mumble variable length integer.
+     *
+     * Leading bits select the form:
+     *   0xxxxxxx            7 bit positive
+     *   10xxxxxx + 1b       14 bit positive
+     *   110xxxxx + 2b       21 bit positive
+     *   1110xxxx + 3b       28 bit positive
+     *   111100__ + 4b       32 bit positive
+     *   111101__ + 8b       64 bit
+     *   111110__ + varint   negative recursive
+     *   111111xx            negative two bit
+     *
+     * Decoding looks up size and value bits of the leading byte in a table and
+     * never reads past the given length.
+     */
     class VarInt {
     public:
-        explicit VarInt(const uint8_t* buf);
+        //longest encoding, 64 bit form
+        static constexpr size_t MaxSize = 9;
+
+        //throws VarIntException when buffer ends before the value
+        VarInt(const uint8_t* buf, size_t length)
+        {
+            _size = Decode(buf, length, _val);
+            if (!_size) {
+                throw VarIntException("truncated varint");
+            }
+        }
+
+        template <std::integral T>
+        explicit constexpr VarInt(T val) : _val(static_cast<int64_t>(val)), _size(EncodedSize(static_cast<int64_t>(val)))
+        {
+        }
+
+        [[nodiscard]] constexpr size_t Size() const
+        {
+            return _size;
+        }
+
+        [[nodiscard]] constexpr int64_t Value() const
+        {
+            return _val;
+        }
+
+        [[nodiscard]] std::vector<uint8_t> Encode() const
+        {
+            std::vector<uint8_t> result(MaxSize);
+            result.resize(Encode(_val, result.data()));
+            return result;
+        }
+
+        //bytes needed to encode value
+        [[nodiscard]] static constexpr size_t EncodedSize(int64_t value)
+        {
+            auto uvalue = static_cast<uint64_t>(value);
+            size_t prefix = 0;
+
+            if (value < 0 && ~uvalue < 0x100000000ULL) {
+                uvalue = ~uvalue;
+                if (uvalue <= 0x3) {
+                    return 1;
+                }
+                prefix = 1;
+            }
+
+            if (uvalue < 0x80) {
+                return prefix + 1;
+            }
+            if (uvalue < 0x4000) {
+                return prefix + 2;
+            }
+            if (uvalue < 0x200000) {
+                return prefix + 3;
+            }
+            if (uvalue < 0x10000000) {
+                return prefix + 4;
+            }
+            if (uvalue < 0x100000000ULL) {
+                return prefix + 5;
+            }
+            return prefix + 9;
+        }
+
+        //writes at most MaxSize bytes, returns bytes written
+        static constexpr size_t Encode(int64_t value, uint8_t* out)
+        {
+            auto uvalue = static_cast<uint64_t>(value);
+            size_t pos = 0;
+
+            //small negatives are stored as complement, large ones fall through to the 64 bit form
+            if (value < 0 && ~uvalue < 0x100000000ULL) {
+                uvalue = ~uvalue;
+                if (uvalue <= 0x3) {
+                    out[0] = static_cast<uint8_t>(0xFC | uvalue);
+                    return 1;
+                }
+                out[pos++] = 0xF8;
+            }
+
+            size_t size = EncodedSize(static_cast<int64_t>(uvalue));
+            size_t bytes = size - 1;
+
+            if (size == 5) {
+                out[pos++] = 0xF0;
+            }
+            else if (size == 9) {
+                out[pos++] = 0xF4;
+            }
+            else {
+                //prefix bits and top value bits share the leading byte
+                out[pos++] = static_cast<uint8_t>(_prefixes[size] | (uvalue >> (bytes * 8)));
+            }
+
+            for (size_t i = bytes; i > 0; i--) {
+                out[pos++] = static_cast<uint8_t>(uvalue >> ((i - 1) * 8));
+            }
+
+            return pos;
+        }
+
+        //returns bytes consumed, 0 when buffer ends before the value
+        static constexpr size_t Decode(const uint8_t* buf, size_t length, int64_t& value) noexcept
+        {
+            //positive forms up to 28 bit are one big endian word load, shifted and masked by the table
+            if (length >= 8 && buf[0] < 0xF0) {
+                const auto& lead = varint_detail::lead_table[buf[0]];
+                uint64_t word = 0;
+                for (size_t i = 0; i < 8; i++) {
+                    word = (word << 8) | buf[i];
+                }
+                size_t bits = (lead.size - 1) * 8;
+                value = static_cast<int64_t>((word >> (56 - bits)) & ((uint64_t(lead.mask) << bits) | ((uint64_t(1) << bits) - 1)));
+                return lead.size;
+            }
+
+            //unwrap negative recursive prefixes, complement is applied once per prefix
+            size_t pos = 0;
+            bool negate = false;
+            while (pos < length && (buf[pos] & 0xFC) == 0xF8) {
+                negate = !negate;
+                pos++;
+            }
+
+            if (pos >= length) {
+                return 0;
+            }
+
+            uint8_t lead = buf[pos];
+            size_t size = varint_detail::lead_table[lead].size;
+            if (size > length - pos) {
+                return 0;
+            }
+
+            uint64_t uvalue = lead & varint_detail::lead_table[lead].mask;
+            for (size_t i = 1; i < size; i++) {
+                uvalue = (uvalue << 8) | buf[pos + i];
+            }
 
-        explicit VarInt(int8_t val);
-        explicit VarInt(int16_t val);
-        explicit VarInt(int32_t val);
-        explicit VarInt(uint32_t val);
-        explicit VarInt(int64_t val);
+            //negative two bit carries the complement in the leading byte
+            if ((lead & 0xFC) == 0xFC) {
+                uvalue = ~uvalue;
+            }
 
-        [[nodiscard]] size_t Size() const;
-        [[nodiscard]] size_t Value() const;
+            value = static_cast<int64_t>(negate ? ~uvalue : uvalue);
+            return pos + size;
+        }
 
-        [[nodiscard]] std::vector<uint8_t> Encode() const;
-        
     private:
-        void parse(const uint8_t* buf);
+        //leading byte prefix by encoded size, for the forms that keep value bits in it
+        static constexpr std::array<uint8_t, 5> _prefixes = { 0x00, 0x00, 0x80, 0xC0, 0xE0 };
 
     private:
         int64_t _val = 0;
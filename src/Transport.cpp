@@ -2,17 +2,50 @@
 // Copyright (c) 2015-2022 mumlib2 contributors
 
 //stdlib
+#include <algorithm>
+#include <cstring>
 #include <map>
 #include <thread>
 
+//linux
+#if defined(__linux__)
+#include <linux/sock_diag.h>
+#include <sys/socket.h>
+#endif
+
 //mumlib
 #include "mumlib2/exceptions.h"
+#include "mumlib2_private/tls_context_private.h"
+#include "mumlib2_private/tracer.h"
 #include "mumlib2_private/transport.h"
 #include "mumble.pb.h"
 
 using namespace std::literals::chrono_literals;
 
 static auto PING_INTERVAL = 4s;
+static auto UDP_PING_INTERVAL = 1s;
+
+//UDPTUNNEL message type(2) + length(4) in front of every tunneled voice packet
+static const uint32_t UDPTUNNEL_HEADER_LENGTH = 6;
+
+//head start of each connection attempt before the next address is tried in parallel, RFC 8305
+static auto CONNECT_ATTEMPT_DELAY = 250ms;
+
+//consecutive unanswered UDP pings before voice moves to the TLS tunnel
+static const uint32_t UDP_PING_LOST_MAX = 3;
+
+//io timer ticks later than this count as missed deadline
+static auto IO_DEADLINE_TOLERANCE = 5ms;
+
+//consecutive UDP decrypt failures before the server is asked for a fresh nonce
+static const uint32_t CRYPT_RESYNC_FAILURES = 8;
+
+//minimal time between two resync requests
+static auto CRYPT_RESYNC_INTERVAL = 5s;
+
+//older echoes belong to an earlier connection
+static const uint64_t UDP_PING_RTT_MAX_MS = 10000;
+
 const long CLIENT_VERSION = 0x01020A;
 const std::string CLIENT_RELEASE("Mumlib2");
 const std::string CLIENT_OS("OS Unknown");
@@ -31,21 +64,34 @@ static std::map<MumbleProto::Reject_RejectType, std::string> rejectMessages = {
 };
 
 namespace mumlib2 {
+	static uint64_t pingTimestamp() {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
 	Transport::Transport(
 		std::function<bool(MessageType, uint8_t*, int)> processMessageFunc,
 		std::function<bool(AudioPacket&)> processEncodedAudioPacketFunction,
-		std::string cert_file,
-		std::string privkey_file) :
+		std::function<void(const std::error_code&)> processErrorFunction,
+		std::function<void(ConnectionState)> processStateFunction,
+		std::function<void(bool)> processUdpStateFunction,
+		std::shared_ptr<TlsContext> tlsContext) :
 		logger("mumlib.Transport"),
 		processMessageFunction(std::move(processMessageFunc)),
 		processEncodedAudioPacketFunction(std::move(processEncodedAudioPacketFunction)),
+		processErrorFunction(std::move(processErrorFunction)),
+		processStateFunction(std::move(processStateFunction)),
+		processUdpStateFunction(std::move(processUdpStateFunction)),
 		udpSocket(ioService),
-		sslContext(asio::ssl::context::sslv23),
-		sslContextHelper(sslContext, cert_file, privkey_file),
-		sslSocket(ioService, sslContext),
-		pingTimer(ioService, std::chrono::seconds(PING_INTERVAL)) {
+		resolver(ioService),
+		connectAttemptTimer(ioService),
+		tlsContext(std::move(tlsContext)),
+		pingTimer(ioService, std::chrono::seconds(PING_INTERVAL)),
+		udpPingTimer(ioService, UDP_PING_INTERVAL),
+		reconnectTimer(ioService),
+		reconnectRandom(std::random_device{}()) {
 
 		pingTimer.async_wait(std::bind(&Transport::pingTimerTick, this, std::placeholders::_1));
+		udpPingTimer.async_wait(std::bind(&Transport::udpPingTimerTick, this, std::placeholders::_1));
 	}
 
 	Transport::~Transport() {
@@ -56,52 +102,380 @@ namespace mumlib2 {
 
 		logger.log("Mumlib2::Transport::connect()");
 
-		std::error_code errorCode;
-
 		connectionParams = make_pair(host, port);
 		credentials = make_pair(user, password);
+		lastError.clear();
+		reconnectAttempt = 0;
+
+		try {
+			startConnect();
+		}
+		catch (std::runtime_error& exp) {
+			logger.log("Mumlib2::Transport::connect() -> failed to establish connection", exp.what());
+			throwTransportException(std::string("failed to establish connection: ") + exp.what());
+		}
+	}
+
+	void Transport::setReconnect(bool enabled, std::chrono::milliseconds delay_min, std::chrono::milliseconds delay_max) {
+		reconnectEnabled = enabled;
+		reconnectDelayMin = delay_min;
+		reconnectDelayMax = std::max(delay_min, delay_max);
+	}
+
+	//integer socket option asio does not wrap
+	class IntegerOption {
+	public:
+		IntegerOption(int level, int name, int value) : _level(level), _name(name), _value(value) {}
+
+		template <typename Protocol> int level(const Protocol&) const { return _level; }
+		template <typename Protocol> int name(const Protocol&) const { return _name; }
+		template <typename Protocol> const int* data(const Protocol&) const { return &_value; }
+		template <typename Protocol> size_t size(const Protocol&) const { return sizeof(_value); }
+
+	private:
+		int _level;
+		int _name;
+		int _value;
+	};
+
+	template <typename Socket>
+	void Transport::applySocketOptions(Socket& socket, bool v6, bool udp) {
+		std::error_code errorCode;
+
+		if (options.dscp >= 0) {
+			//DSCP is the upper six bits of the traffic class, ECN bits stay zero
+			int tos = options.dscp << 2;
+			if (v6) {
+#if defined(IPV6_TCLASS)
+				socket.set_option(IntegerOption(IPPROTO_IPV6, IPV6_TCLASS, tos), errorCode);
+#endif
+			}
+			else {
+				socket.set_option(IntegerOption(IPPROTO_IP, IP_TOS, tos), errorCode);
+			}
+			if (errorCode) {
+				logger.warn("Setting DSCP %d failed: %s.", options.dscp, errorCode.message().c_str());
+			}
+		}
+
+		if (options.receive_buffer) {
+			socket.set_option(asio::socket_base::receive_buffer_size(static_cast<int>(options.receive_buffer)), errorCode);
+			if (errorCode) {
+				logger.warn("Setting receive buffer of %d B failed: %s.", options.receive_buffer, errorCode.message().c_str());
+			}
+		}
+
+		if (options.send_buffer) {
+			socket.set_option(asio::socket_base::send_buffer_size(static_cast<int>(options.send_buffer)), errorCode);
+			if (errorCode) {
+				logger.warn("Setting send buffer of %d B failed: %s.", options.send_buffer, errorCode.message().c_str());
+			}
+		}
+
+		if (!udp) {
+			return;
+		}
+
+#if defined(__linux__) && defined(SO_BUSY_POLL)
+		if (options.busy_poll_us) {
+			socket.set_option(IntegerOption(SOL_SOCKET, SO_BUSY_POLL, static_cast<int>(options.busy_poll_us)), errorCode);
+			if (errorCode) {
+				logger.warn("Setting busy poll of %d us failed: %s.", options.busy_poll_us, errorCode.message().c_str());
+			}
+		}
+#endif
+
+#if defined(__linux__) && defined(SO_TIMESTAMPNS)
+		if (options.timestamps) {
+			socket.set_option(IntegerOption(SOL_SOCKET, SO_TIMESTAMPNS, 1), errorCode);
+			if (errorCode) {
+				logger.warn("Enabling receive timestamps failed: %s.", errorCode.message().c_str());
+			}
+			udpTimestamps = !errorCode;
+		}
+#endif
+	}
+
+	void Transport::updateKernelDrops() {
+#if defined(__linux__) && defined(SO_MEMINFO)
+		if (!udpSocket.is_open()) {
+			return;
+		}
+
+		uint32_t meminfo[SK_MEMINFO_VARS] = {};
+		socklen_t length = sizeof(meminfo);
+		if (getsockopt(udpSocket.native_handle(), SOL_SOCKET, SO_MEMINFO, meminfo, &length) == 0 && length > SK_MEMINFO_DROPS * sizeof(uint32_t)) {
+			//counter belongs to the socket, a new connection starts from zero
+			udpKernelDrops = udpKernelDropsBase + meminfo[SK_MEMINFO_DROPS];
+		}
+#endif
+	}
+
+	void Transport::startConnect() {
+		const auto& [host, port] = connectionParams;
+
 		udpActive = false;
-		state = ConnectionState::IN_PROGRESS;
+		udpReceiving = false;
+		udpPingsUnanswered = 0;
+		udpDecryptFailures = 0;
+		ping_state = PingState::NONE;
+		cryptState.reset();
+		setState(ConnectionState::IN_PROGRESS);
+
+		//the previous stream is only dropped here, the aborted handlers of its operations have run by now
+		sslSocket = std::make_unique<asio::ssl::stream<asio::ip::tcp::socket>>(ioService, tlsContext->impl->GetContext());
 
 		logger.log("Mumlib2::Transport::connect() -> verify mode");
-		sslSocket.set_verify_mode(asio::ssl::verify_peer);
+		sslSocket->set_verify_mode(asio::ssl::verify_peer);
 
 		//todo for now it accepts every certificate, move it to callback
 		logger.log("Mumlib2::Transport::connect() -> verify verify callback");
-		sslSocket.set_verify_callback([](bool preverified, asio::ssl::verify_context& ctx) { return true; });
+		sslSocket->set_verify_callback([](bool preverified, asio::ssl::verify_context& ctx) { return true; });
+
+		//resume the last session with this server, it then skips the certificate exchange and key agreement
+		SSL_SESSION* session = tlsContext->impl->SessionGet(sessionKey());
+		if (session) {
+			SSL_set_session(sslSocket->native_handle(), session);
+			SSL_SESSION_free(session);
+		}
 
 		logger.log("Mumlib2::Transport::connect() -> trying to connect");
+		connectStarted = std::chrono::steady_clock::now();
 
-		try {
-			logger.log("Mumlib2::Transport::connect() -> udp");
-			asio::ip::udp::resolver resolverUdp(ioService);
-			asio::ip::udp::resolver::query queryUdp(asio::ip::udp::v4(), host, std::to_string(port));
-			udpReceiverEndpoint = *resolverUdp.resolve(queryUdp);
-			udpSocket.open(asio::ip::udp::v4());
+		//one lookup for both address families, UDP follows whichever TCP connection wins
+		auto generation = ++connectGeneration;
+		resolver.async_resolve(host, std::to_string(port),
+			[this, generation](const std::error_code& ec, asio::ip::tcp::resolver::results_type results) {
+				resolveHandler(generation, ec, results);
+			});
+	}
+
+	void Transport::resolveHandler(uint32_t generation, const std::error_code& error, const asio::ip::tcp::resolver::results_type& results) {
+		if (generation != connectGeneration) {
+			return;
+		}
+
+		if (error) {
+			handleError(TransportError::CONNECT_FAILED, "resolve: " + error.message());
+			return;
+		}
+
+		//IPv6 first, then families alternate so a broken one costs one attempt delay at most
+		std::vector<asio::ip::tcp::endpoint> endpointsV6;
+		std::vector<asio::ip::tcp::endpoint> endpointsV4;
+		for (const auto& entry : results) {
+			auto& endpoints = entry.endpoint().address().is_v6() ? endpointsV6 : endpointsV4;
+			endpoints.push_back(entry.endpoint());
+		}
+
+		connectEndpoints.clear();
+		for (size_t i = 0; i < std::max(endpointsV6.size(), endpointsV4.size()); i++) {
+			if (i < endpointsV6.size()) {
+				connectEndpoints.push_back(endpointsV6[i]);
+			}
+			if (i < endpointsV4.size()) {
+				connectEndpoints.push_back(endpointsV4[i]);
+			}
+		}
+
+		if (connectEndpoints.empty()) {
+			handleError(TransportError::CONNECT_FAILED, "resolve: no addresses");
+			return;
+		}
+
+		connectAttempts.clear();
+		connectAttemptsPending = 0;
+		startConnectAttempt(generation);
+	}
+
+	void Transport::startConnectAttempt(uint32_t generation) {
+		size_t index = connectAttempts.size();
+		if (index >= connectEndpoints.size()) {
+			return;
+		}
+
+		logger.log("Mumlib2::Transport::connect() -> async_connect %s", connectEndpoints[index].address().to_string().c_str());
+
+		connectAttempts.push_back(std::make_unique<asio::ip::tcp::socket>(ioService));
+		connectAttemptsPending++;
+
+		//options have to be set before the handshake to cover SYN and buffer negotiation
+		std::error_code errorCode;
+		connectAttempts[index]->open(connectEndpoints[index].protocol(), errorCode);
+		if (!errorCode) {
+			applySocketOptions(*connectAttempts[index], connectEndpoints[index].address().is_v6(), false);
+		}
+		connectAttempts[index]->async_connect(connectEndpoints[index],
+			[this, generation, index](const std::error_code& ec) {
+				connectAttemptHandler(generation, index, ec);
+			});
+
+		if (index + 1 < connectEndpoints.size()) {
+			connectAttemptTimer.expires_after(CONNECT_ATTEMPT_DELAY);
+			//cancel() does not reach a tick that is already queued, it only starts the attempt it was armed for,
+			//a winner clears the attempts and a failed attempt may have started the next one already
+			connectAttemptTimer.async_wait([this, generation, next = index + 1](const std::error_code& ec) {
+				if (ec || generation != connectGeneration || connectAttempts.size() != next) {
+					return;
+				}
+				startConnectAttempt(generation);
+			});
+		}
+	}
+
+	void Transport::connectAttemptHandler(uint32_t generation, size_t index, const std::error_code& error) {
+		if (generation != connectGeneration) {
+			return;
+		}
+
+		connectAttemptsPending--;
+
+		if (error) {
+			logger.warn("Connect to %s failed: %s.", connectEndpoints[index].address().to_string().c_str(), error.message().c_str());
+
+			//no reason to wait for the timer, the next address goes right away
+			if (connectAttempts.size() < connectEndpoints.size()) {
+				connectAttemptTimer.cancel();
+				startConnectAttempt(generation);
+			}
+			else if (connectAttemptsPending == 0) {
+				sslConnectHandler(error);
+			}
+			return;
+		}
+
+		//losers are closed with the vector, their handlers see a stale generation
+		connectGeneration++;
+		connectAttemptTimer.cancel();
+		sslSocket->next_layer() = std::move(*connectAttempts[index]);
+		connectAttempts.clear();
+
+		const auto& endpoint = connectEndpoints[index];
+		logger.log("Mumlib2::Transport::connect() -> connected to %s", endpoint.address().to_string().c_str());
+
+		//voice goes to the same address over the same family
+		std::error_code errorCode;
+		udpReceiverEndpoint = asio::ip::udp::endpoint(endpoint.address(), endpoint.port());
+		udpSocket.open(endpoint.address().is_v6() ? asio::ip::udp::v6() : asio::ip::udp::v4(), errorCode);
+		if (errorCode) {
+			logger.warn("UDP socket open failed: %s, voice goes through the TLS tunnel.", errorCode.message().c_str());
+		}
+		else {
+			applySocketOptions(udpSocket, endpoint.address().is_v6(), true);
 
 			std::array<char, 1> send_buf = { 0 };
-			udpSocket.send_to(asio::buffer(send_buf), udpReceiverEndpoint);
+			udpSocket.send_to(asio::buffer(send_buf), udpReceiverEndpoint, 0, errorCode);
 
+			udpReceiving = true;
 			doReceiveUdp();
+		}
+
+		sslConnectHandler(error);
+	}
+
+	void Transport::scheduleReconnect() {
+		//exponential backoff with equal jitter, so a restarted server is not hit by the whole fleet at once
+		auto delay = reconnectDelayMin * (int64_t(1) << std::min(reconnectAttempt, 16u));
+		delay = std::min(delay, reconnectDelayMax);
+
+		std::uniform_int_distribution<int64_t> jitter(0, delay.count() / 2);
+		delay = delay / 2 + std::chrono::milliseconds(jitter(reconnectRandom));
+
+		reconnectAttempt++;
+		setState(ConnectionState::RECONNECTING);
+
+		logger.warn("Reconnect attempt %d in %d ms.", reconnectAttempt, delay.count());
+
+		reconnectTimer.expires_after(delay);
+		reconnectTimer.async_wait([this](const std::error_code& ec) {
+			if (ec || state != ConnectionState::RECONNECTING) {
+				return;
+			}
+
+			reconnects++;
+
+			try {
+				startConnect();
+			}
+			catch (std::runtime_error& exp) {
+				logger.warn("Reconnect failed: %s.", exp.what());
+				closeSockets();
+				scheduleReconnect();
+			}
+		});
+	}
+
+	void Transport::closeSockets() {
+		std::error_code errorCode;
 
-			logger.log("Mumlib2::Transport::connect() -> tcp");
-			asio::ip::tcp::resolver resolverTcp(ioService);
-			asio::ip::tcp::resolver::query queryTcp(host, std::to_string(port));
+		updateKernelDrops();
+		udpKernelDropsBase = udpKernelDrops;
 
-			logger.log("Mumlib2::Transport::connect() -> async_connect");
-			async_connect(
-				sslSocket.lowest_layer(),
-				resolverTcp.resolve(queryTcp),
-				bind(&Transport::sslConnectHandler, this, std::placeholders::_1));
+		//pending lookups and attempts end with a stale generation
+		connectGeneration++;
+		resolver.cancel();
+		connectAttemptTimer.cancel();
+		connectAttempts.clear();
 
+		if (sslSocket) {
+			sslSocket->lowest_layer().close(errorCode);
 		}
-		catch (std::runtime_error& exp) {
-			logger.log("Mumlib2::Transport::connect() -> failed to establish connection", exp.what());
-			throwTransportException(std::string("failed to establish connection: ") + exp.what());
+
+		udpSocket.shutdown(asio::ip::udp::socket::shutdown_both, errorCode);
+		udpSocket.close(errorCode);
+		if (errorCode) {
+			logger.warn("Not ping: UDP socket close returned error: %s.", errorCode.message().c_str());
+		}
+
+		udpActive = false;
+		udpTimestamps = false;
+	}
+
+	void Transport::saveSslSession() {
+		SSL_SESSION* session = SSL_get1_session(sslSocket->native_handle());
+		if (!session) {
+			return;
+		}
+
+		if (!SSL_SESSION_is_resumable(session)) {
+			SSL_SESSION_free(session);
+			return;
+		}
+
+		tlsContext->impl->SessionPut(sessionKey(), session);
+	}
+
+	std::string Transport::sessionKey() const {
+		return connectionParams.first + ":" + std::to_string(connectionParams.second);
+	}
+
+	void Transport::setState(ConnectionState newState) {
+		if (state == newState) {
+			return;
+		}
+
+		state = newState;
+
+		if (processStateFunction) {
+			processStateFunction(newState);
 		}
 	}
 
 	void Transport::disconnect()
+	{
+		//sockets and timers belong to the io thread while it runs
+		auto ioThread = runThread.load();
+		if (ioThread != std::thread::id() && ioThread != std::this_thread::get_id()) {
+			asio::post(ioService, [this]() {
+				disconnectPrivate();
+			});
+			return;
+		}
+
+		disconnectPrivate();
+	}
+
+	void Transport::disconnectPrivate()
 	{
 		logger.log("Mumlib2::Transport::disconnect()");
 
@@ -109,20 +483,12 @@ namespace mumlib2 {
 
 		ioService.stop();
 
-		if (state != ConnectionState::NOT_CONNECTED) {
-			std::error_code errorCode;
+		reconnectTimer.cancel();
 
-			// todo perform different operations for each ConnectionState
-			sslSocket.lowest_layer().close(errorCode);
+		// todo perform different operations for each ConnectionState
+		closeSockets();
 
-			udpSocket.shutdown(asio::ip::udp::socket::shutdown_both, errorCode);
-			udpSocket.close(errorCode);
-			if (errorCode) {
-				logger.warn("Not ping: UDP socket close returned error: %s.", errorCode.message().c_str());
-			}
-
-			state = ConnectionState::NOT_CONNECTED;
-		}
+		setState(ConnectionState::NOT_CONNECTED);
 	}
 
 	void Transport::sendVersion() {
@@ -147,10 +513,13 @@ namespace mumlib2 {
 		authenticate.clear_celt_versions();
 		authenticate.set_opus(true);
 		authenticate.clear_tokens();
+
+		//kept for the authentication of reconnects
 		if (tokens.has_value()) {
-			for (const auto& token : *tokens) {
-				authenticate.add_tokens(token);
-			}
+			authTokens = *tokens;
+		}
+		for (const auto& token : authTokens) {
+			authenticate.add_tokens(token);
 		}
 
 		sendControlMessagePrivate(MessageType::AUTHENTICATE, authenticate);
@@ -160,15 +529,24 @@ namespace mumlib2 {
 		logger.log("Mumlib2::Transport::sendSslPing()");
 
 		if (ping_state == PingState::PING) {
-			logger.warn("Continue sending SSL ping.");
-			disconnect();
+			handleError(TransportError::PING_TIMEOUT);
 			return;
 		}
 
 		ping_state = PingState::PING;
 		MumbleProto::Ping ping;
 
-		ping.set_timestamp(std::time(nullptr));
+		//echoed back by the server, used for rtt
+		ping.set_timestamp(pingTimestamp());
+
+		ping.set_good(cryptState.getGood());
+		ping.set_late(cryptState.getLate());
+		ping.set_lost(cryptState.getLost());
+		ping.set_resync(cryptState.getResync());
+
+		//lets the server show our view of both paths
+		ping.set_udp_ping_avg(static_cast<float>(udpPingRttMs));
+		ping.set_tcp_ping_avg(static_cast<float>(tcpPingRttMs));
 
 		sendControlMessagePrivate(MessageType::PING, ping);
 	}
@@ -180,75 +558,159 @@ namespace mumlib2 {
 
 	void Transport::doReceiveUdp()
 	{
+#if defined(__linux__) && defined(SO_TIMESTAMPNS)
+		if (udpTimestamps) {
+			doReceiveUdpTimestamped();
+			return;
+		}
+#endif
+
 		udpSocket.async_receive_from(
 			asio::buffer(udpIncomingBuffer, MUMBLE_UDP_MAXLENGTH),
 			udpReceiverEndpoint,
 			[this](const std::error_code& ec, size_t bytesTransferred) {
 				if (!ec && bytesTransferred > 0) {
-					logger.warn("Received UDP packet of %d B.", bytesTransferred);
-
-					if (!cryptState.isValid()) {
-						throwTransportException("received UDP packet before: CRYPT SETUP message");
-					}
-					else {
-						lastReceivedUdpPacketTimestamp = std::chrono::system_clock::now();
-
-						if (udpActive == false) {
-							udpActive = true;
-							logger.warn("UDP is up.");
-						}
-
-						uint8_t plainBuffer[1024];
-						const int plainBufferLength = static_cast<const int>(bytesTransferred - 4);
+					processUdpDatagram(bytesTransferred, std::chrono::system_clock::now(), false);
+					doReceiveUdp();
+				}
+				else {
+					handleUdpReceiveError(ec);
+				}
+			});
+	}
 
-						bool success = cryptState.decrypt(
-							udpIncomingBuffer, plainBuffer, static_cast<unsigned int>(bytesTransferred));
+#if defined(__linux__) && defined(SO_TIMESTAMPNS)
+	void Transport::doReceiveUdpTimestamped()
+	{
+		//asio does not expose ancillary data, wait for readiness and read the datagram with recvmsg()
+		udpSocket.async_wait(asio::socket_base::wait_read, [this](const std::error_code& ec) {
+			if (ec) {
+				handleUdpReceiveError(ec);
+				return;
+			}
 
-						if (!success) {
-							throwTransportException("UDP packet: decryption failed");
-						}
+			iovec iov{ udpIncomingBuffer, MUMBLE_UDP_MAXLENGTH };
+			alignas(cmsghdr) uint8_t control[CMSG_SPACE(sizeof(timespec))];
 
-						auto packet = AudioPacket::Decode(plainBuffer, plainBufferLength, 0);
-						processEncodedAudioPacketFunction(packet);
-					}
+			msghdr message{};
+			message.msg_iov = &iov;
+			message.msg_iovlen = 1;
+			message.msg_control = control;
+			message.msg_controllen = sizeof(control);
 
+			ssize_t bytesTransferred = ::recvmsg(udpSocket.native_handle(), &message, MSG_DONTWAIT);
+			if (bytesTransferred < 0) {
+				if (errno == EAGAIN || errno == EWOULDBLOCK) {
 					doReceiveUdp();
 				}
-				else if (ec == asio::error::operation_aborted) {
-					std::error_code errorCode;
-					logger.warn("UDP receive function cancelled.");
-					if (ping_state == PingState::PING) {
-						logger.warn("UDP receive function cancelled PONG.");
-					}
-				}
 				else {
-					throwTransportException("UDP receive failed: " + ec.message());
+					handleUdpReceiveError(std::error_code(errno, std::system_category()));
 				}
-			});
+				return;
+			}
+
+			//falls back to our own clock when the kernel did not attach a timestamp
+			auto arrival = std::chrono::system_clock::now();
+			bool kernel = false;
+			for (cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+				if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+					timespec timestamp;
+					std::memcpy(&timestamp, CMSG_DATA(cmsg), sizeof(timestamp));
+					arrival = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+						std::chrono::seconds(timestamp.tv_sec) + std::chrono::nanoseconds(timestamp.tv_nsec)));
+					kernel = true;
+				}
+			}
+
+			if (bytesTransferred > 0) {
+				processUdpDatagram(static_cast<size_t>(bytesTransferred), arrival, kernel);
+			}
+			doReceiveUdp();
+		});
+	}
+#endif
+
+	void Transport::processUdpDatagram(size_t bytesTransferred, std::chrono::system_clock::time_point arrival, bool kernel)
+	{
+		MUMLIB2_TRACE_SCOPE("Transport::doReceiveUdp", TRANSPORT);
+		logger.warn("Received UDP packet of %d B.", bytesTransferred);
+
+		//time the datagram waited in the socket queue for the io thread
+		if (kernel) {
+			auto delay = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - arrival).count();
+			uint32_t delayUs = static_cast<uint32_t>(std::clamp<int64_t>(delay, 0, UINT32_MAX));
+
+			uint32_t average = udpReceiveDelayUs;
+			udpReceiveDelayUs = average ? (average * 7 + delayUs) / 8 : std::max(delayUs, 1u);
+			if (delayUs > udpReceiveDelayMaxUs) {
+				udpReceiveDelayMaxUs = delayUs;
+			}
+		}
+
+		uint8_t plainBuffer[1024];
+
+		if (!cryptState.isValid()) {
+			handleError(TransportError::UDP_BEFORE_CRYPT_SETUP);
+		}
+		else if (bytesTransferred <= 4) {
+			audioPacketsMalformed++;
+			logger.warn("Dropped UDP packet of %d B: shorter than crypt header.", bytesTransferred);
+		}
+		else if (!cryptState.decrypt(udpIncomingBuffer, plainBuffer, static_cast<unsigned int>(bytesTransferred))) {
+			handleError(TransportError::UDP_DECRYPT_FAILED);
+
+			//a streak means our nonce drifted too far from the server one
+			if (++udpDecryptFailures >= CRYPT_RESYNC_FAILURES) {
+				requestCryptResync();
+			}
+		}
+		else {
+			udpDecryptFailures = 0;
+			processAudioPacketInternal(plainBuffer, bytesTransferred - 4, true, arrival, kernel);
+		}
+	}
+
+	void Transport::handleUdpReceiveError(const std::error_code& ec)
+	{
+		if (ec == asio::error::operation_aborted) {
+			udpReceiving = false;
+			logger.warn("UDP receive function cancelled.");
+			if (ping_state == PingState::PING) {
+				logger.warn("UDP receive function cancelled PONG.");
+			}
+		}
+		else {
+			//rearmed by the ping timer, so a refusing peer does not spin the io thread
+			udpReceiving = false;
+			handleError(TransportError::UDP_RECEIVE_FAILED, ec.message());
+		}
 	}
 
 	void Transport::sslConnectHandler(const std::error_code& error) {
 		if (!error) {
-			sslSocket.async_handshake(asio::ssl::stream_base::client,
+			sslSocket->async_handshake(asio::ssl::stream_base::client,
 				std::bind(&Transport::sslHandshakeHandler, this,
 					std::placeholders::_1));
 		}
 		else {
-			disconnect();
+			handleError(TransportError::CONNECT_FAILED, error.message());
 		}
 	}
 
 	void Transport::sslHandshakeHandler(const std::error_code& error)
 	{
-		std::error_code errorCode = error;
 		if (!error) {
+			if (SSL_session_reused(sslSocket->native_handle())) {
+				tlsSessionsResumed++;
+			}
+
 			doReceiveSsl();
 
 			sendVersion();
 			sendAuthentication({});
 		}
 		else {
-			throwTransportException(std::string("Handshake failed: ") + error.message());
+			handleError(TransportError::HANDSHAKE_FAILED, error.message());
 		}
 	}
 
@@ -256,19 +718,6 @@ namespace mumlib2 {
 		if (state == ConnectionState::CONNECTED) {
 
 			sendSslPing();
-
-			using namespace std::chrono;
-
-			logger.warn("pingTimerTick: Sending UDP ping.");
-			sendUdpPing();
-
-			if (udpActive) {
-				const auto lastUdpReceivedMilliseconds = duration_cast<milliseconds>(system_clock::now() - lastReceivedUdpPacketTimestamp).count();
-				if (lastUdpReceivedMilliseconds > PING_INTERVAL.count() * 1000 + 1000) {
-					logger.warn("Didn't receive UDP ping in %d ms, falling back to TCP.", lastUdpReceivedMilliseconds);
-				}
-			}
-
 		}
 
 		if ((state == ConnectionState::NOT_CONNECTED) && (ping_state == PingState::PING)) {
@@ -281,9 +730,80 @@ namespace mumlib2 {
 		pingTimer.async_wait(std::bind(&Transport::pingTimerTick, this, std::placeholders::_1));
 	}
 
+	void Transport::udpPingTimerTick(const std::error_code& e) {
+		//a starved io thread delays voice the same way it delays this tick
+		auto lateness = std::chrono::steady_clock::now() - udpPingTimer.expiry();
+		if (lateness > IO_DEADLINE_TOLERANCE) {
+			ioDeadlineMisses++;
+		}
+		auto latenessUs = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(lateness).count());
+		if (latenessUs > ioLatenessMaxUs) {
+			ioLatenessMaxUs = latenessUs;
+		}
+
+		updateKernelDrops();
+
+		if (state == ConnectionState::CONNECTED && cryptState.isValid()) {
+			if (!udpReceiving) {
+				udpReceiving = true;
+				doReceiveUdp();
+			}
+
+			//answered pings prove both directions, voice alone only the way in
+			if (udpActive && udpPingsUnanswered >= UDP_PING_LOST_MAX) {
+				setUdpActive(false, "UDP pings unanswered");
+			}
+
+			//keeps probing while voice goes through the tunnel, the first answer switches back
+			sendUdpPing();
+		}
+
+		udpPingTimer.expires_at(udpPingTimer.expires_at() + UDP_PING_INTERVAL);
+		udpPingTimer.async_wait(std::bind(&Transport::udpPingTimerTick, this, std::placeholders::_1));
+	}
+
+	void Transport::setUdpActive(bool active, const char* reason) {
+		if (udpActive == active) {
+			return;
+		}
+
+		udpActive = active;
+
+		if (active) {
+			udpRecoveries++;
+			logger.warn("UDP is up: %s.", reason);
+		}
+		else {
+			udpFallbacks++;
+			logger.warn("UDP is down, voice goes through the TLS tunnel: %s.", reason);
+		}
+
+		if (processUdpStateFunction) {
+			processUdpStateFunction(active);
+		}
+	}
+
+	void Transport::processUdpPing(uint64_t timestamp) {
+		auto now = pingTimestamp();
+		if (timestamp > now || now - timestamp > UDP_PING_RTT_MAX_MS) {
+			return;
+		}
+
+		udpPingsReceived++;
+		udpPingsUnanswered = 0;
+
+		//smoothed like TCP round trip time estimates, 1/8 weight for the new sample
+		auto rtt = static_cast<uint32_t>(now - timestamp);
+		uint32_t average = udpPingRttMs;
+		udpPingRttMs = average ? (average * 7 + rtt) / 8 : std::max(rtt, 1u);
+
+		setUdpActive(true, "ping answered");
+	}
+
 	void Transport::sendUdpAsync(const uint8_t* buff, int length) {
 		if (length > MUMBLE_UDP_MAXLENGTH - 4) {
-			throwTransportException("maximum allowed: data length is %d" + std::to_string(MUMBLE_UDP_MAXLENGTH - 4));
+			handleError(TransportError::UDP_PACKET_TOO_LARGE, std::to_string(length) + " B");
+			return;
 		}
 
 		const auto bufSize = std::max(MUMBLE_TCP_MAXLENGTH, MUMBLE_UDP_MAXLENGTH);
@@ -302,54 +822,73 @@ namespace mumlib2 {
 				if (!ec && bytesTransferred > 0) {
 					//logger.warn("Sent %d B via UDP.", bytesTransferred);
 				}
-				else {
-					throwTransportException("UDP send failed: " + ec.message());
+				else if (ec != asio::error::operation_aborted) {
+					handleError(TransportError::UDP_SEND_FAILED, ec.message());
 				}
 			});
 	}
 
 	void Transport::doReceiveSsl() {
 		async_read(
-			sslSocket,
-			asio::buffer(sslIncomingBuffer, MUMBLE_TCP_MAXLENGTH),
-			[this](const std::error_code& error, size_t bytesTransferred) -> size_t {
-				if (bytesTransferred < 6) {
-					// we need the message header to determine the payload length
-					return 6 - bytesTransferred;
-				}
-
-				const int payloadSize = ntohl(*reinterpret_cast<uint32_t*>(sslIncomingBuffer.data() + 2));
-				const int wholeMessageLength = payloadSize + 6;
-				size_t remaining = wholeMessageLength - bytesTransferred;
-				remaining = std::max(remaining, (size_t)0);
-
-/*				if (wholeMessageLength > MUMBLE_TCP_MAXLENGTH) {
-					throwTransportException(
-						std::string("message bigger than max allowed size:") + std::to_string(wholeMessageLength) + "/" + std::to_string(MUMBLE_TCP_MAXLENGTH));
-                        }*/
-
-				return remaining;
-			},
+			*sslSocket,
+			asio::buffer(sslIncomingHeader),
 			[this](const std::error_code& ec, size_t bytesTransferred) {
-				if (!ec && bytesTransferred > 0) {
+				if (!ec && bytesTransferred == sslIncomingHeader.size()) {
+					uint16_t messageTypeNetwork;
+					uint32_t payloadLengthNetwork;
+					memcpy(&messageTypeNetwork, sslIncomingHeader.data(), sizeof(messageTypeNetwork));
+					memcpy(&payloadLengthNetwork, sslIncomingHeader.data() + sizeof(messageTypeNetwork), sizeof(payloadLengthNetwork));
+
+					const auto messageType = static_cast<MessageType>(ntohs(messageTypeNetwork));
+					const size_t payloadLength = ntohl(payloadLengthNetwork);
+
+					if (payloadLength + sslIncomingHeader.size() > MUMBLE_TCP_MAXLENGTH) {
+						handleError(TransportError::MESSAGE_TOO_LARGE,
+							std::to_string(payloadLength + sslIncomingHeader.size()) + "/" + std::to_string(MUMBLE_TCP_MAXLENGTH));
+						return;
+					}
+
+					doReceiveSslPayload(messageType, payloadLength);
+				}
+				else {
+					logger.error("SSL receiver error: %s. Bytes transferred: %d.",
+						ec.message().c_str(), bytesTransferred);
+					handleSslReceiveError(ec);
+				}
+			});
+	}
 
-					int messageType = ntohs(*reinterpret_cast<uint16_t*>(sslIncomingBuffer.data()));
+	void Transport::doReceiveSslPayload(MessageType messageType, size_t payloadLength) {
+		//small messages go to the inline buffer, large ones borrow a slab from the shared pool
+		uint8_t* payloadBuffer = sslIncomingInline.data();
+		if (payloadLength > sslIncomingInline.size()) {
+			sslIncomingLarge = BufferPool::Instance().Acquire(payloadLength);
+			payloadBuffer = sslIncomingLarge.Data();
+		}
 
-					//logger.warn("Received %d B of data (%d B payload, type %d).", bytesTransferred,
-					//             bytesTransferred - 6, messageType);
+		async_read(
+			*sslSocket,
+			asio::buffer(payloadBuffer, payloadLength),
+			[this, messageType, payloadBuffer](const std::error_code& ec, size_t bytesTransferred) {
+				if (!ec) {
+					//logger.warn("Received %d B of data (%d B payload, type %d).", bytesTransferred + 6,
+					//             bytesTransferred, messageType);
 
 					processMessageInternal(
-						static_cast<MessageType>(messageType),
-						&sslIncomingBuffer[6],
-						static_cast<int>(bytesTransferred - 6));
+						messageType,
+						payloadBuffer,
+						static_cast<int>(bytesTransferred));
+
+					sslIncomingLarge.Release();
 
 					doReceiveSsl();
 				}
 				else {
+					sslIncomingLarge.Release();
+
 					logger.error("SSL receiver error: %s. Bytes transferred: %d.",
 						ec.message().c_str(), bytesTransferred);
-					//todo temporarily disable exception throwing until issue #6 is solved
-					//throwTransportException("receive failed: " + ec.message());
+					handleSslReceiveError(ec);
 				}
 			});
 	}
@@ -358,8 +897,7 @@ namespace mumlib2 {
 		switch (messageType) {
 
 		case MessageType::UDPTUNNEL: {
-			auto packet = AudioPacket::Decode(buffer, length, 0);
-			processEncodedAudioPacketFunction(packet);
+			processAudioPacketInternal(buffer, length, false, std::chrono::system_clock::now(), false);
 		}
 								   break;
 		case MessageType::AUTHENTICATE: {
@@ -389,6 +927,18 @@ namespace mumlib2 {
 
 			//logger.warn(log.str());
 			ping_state = PingState::PONG;
+
+			if (ping.has_timestamp()) {
+				pingRtt = std::chrono::milliseconds(pingTimestamp() - ping.timestamp());
+				tcpPingRttMs = static_cast<uint32_t>(pingRtt.count());
+			}
+
+			//server counters describe our outgoing stream
+			if (ping.has_good()) {
+				cryptState.setRemoteStats(ping.good(), ping.late(), ping.lost(), ping.resync());
+			}
+
+			processMessageFunction(messageType, buffer, length);
 		}
 							  break;
 		case MessageType::REJECT: {
@@ -406,11 +956,20 @@ namespace mumlib2 {
 				errorMesg << ", reason: " << reject.reason();
 			}
 
-			throwTransportException(errorMesg.str());
+			logger.error(errorMesg.str());
+			handleError(TransportError::REJECTED, errorMesg.str());
 		}
 								break;
 		case MessageType::SERVERSYNC: {
-			state = ConnectionState::CONNECTED;
+			//TLS 1.3 tickets arrive after the handshake, by now they have been read
+			saveSslSession();
+			reconnectAttempt = 0;
+
+			timeToServerSyncMs = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - connectStarted).count());
+			logger.warn("Connected in %d ms.", timeToServerSyncMs.load());
+
+			setState(ConnectionState::CONNECTED);
 
 			logger.warn("SERVERSYNC. Calling external ProcessControlMessageFunction.");
 
@@ -421,10 +980,36 @@ namespace mumlib2 {
 			MumbleProto::CryptSetup cryptsetup;
 			cryptsetup.ParseFromArray(buffer, length);
 
+			//answer to our resync request, only the server nonce changes
+			if (!cryptsetup.has_key() && !cryptsetup.has_client_nonce() && cryptsetup.has_server_nonce()) {
+				if (cryptsetup.server_nonce().length() != AES_BLOCK_SIZE || !cryptState.isValid()) {
+					handleError(TransportError::CRYPT_SETUP_INVALID, "server nonce has invalid length");
+					break;
+				}
+
+				cryptState.setDecryptIV(reinterpret_cast<const unsigned char*>(cryptsetup.server_nonce().c_str()));
+				cryptResyncs++;
+				udpDecryptFailures = 0;
+
+				logger.warn("Crypt resync applied.");
+				break;
+			}
+
+			//server lost our nonce and asks for it
+			if (!cryptsetup.has_key() && !cryptsetup.has_client_nonce() && !cryptsetup.has_server_nonce()) {
+				if (cryptState.isValid()) {
+					MumbleProto::CryptSetup reply;
+					reply.set_client_nonce(std::string(reinterpret_cast<const char*>(cryptState.getEncryptIV()), AES_BLOCK_SIZE));
+					sendControlMessagePrivate(MessageType::CRYPTSETUP, reply);
+				}
+				break;
+			}
+
 			if (cryptsetup.client_nonce().length() != AES_BLOCK_SIZE
 				|| cryptsetup.server_nonce().length() != AES_BLOCK_SIZE
 				|| cryptsetup.key().length() != AES_BLOCK_SIZE) {
-				throwTransportException("one of cryptographic: parameters has invalid length");
+				handleError(TransportError::CRYPT_SETUP_INVALID, "one of cryptographic parameters has invalid length");
+				break;
 			}
 
 			cryptState.setKey(
@@ -433,11 +1018,14 @@ namespace mumlib2 {
 				reinterpret_cast<const unsigned char*>(cryptsetup.server_nonce().c_str()));
 
 			if (!cryptState.isValid()) {
-				throwTransportException("crypt setup: data not valid");
+				handleError(TransportError::CRYPT_SETUP_INVALID, "data not valid");
+				break;
 			}
 
 			logger.warn("Set up cryptography for UDP transport. Sending UDP ping.");
 
+			udpDecryptFailures = 0;
+			udpPingsUnanswered = 0;
 			sendUdpPing();
 
 
@@ -451,10 +1039,87 @@ namespace mumlib2 {
 		}
 	}
 
+	void Transport::requestCryptResync() {
+		auto now = std::chrono::steady_clock::now();
+		if (cryptResyncRequests && now - cryptResyncRequested < CRYPT_RESYNC_INTERVAL) {
+			return;
+		}
+
+		cryptResyncRequested = now;
+		cryptResyncRequests++;
+		logger.warn("%d UDP packets in a row failed to decrypt, requesting crypt resync.", udpDecryptFailures);
+
+		//empty message asks the server for its current nonce
+		MumbleProto::CryptSetup cryptsetup;
+		sendControlMessagePrivate(MessageType::CRYPTSETUP, cryptsetup);
+
+		//voice keeps flowing through the tunnel, the next answered UDP ping switches back
+		setUdpActive(false, "crypt resync");
+	}
+
+	void Transport::processAudioPacketInternal(const uint8_t* buffer, size_t length, bool udp, std::chrono::system_clock::time_point arrival, bool kernel) {
+		//malformed traffic is dropped and counted, it must not tear down the connection
+		auto error = AudioPacket::Parse(buffer, length, 0, audioIncomingPacket);
+		if (error != AudioPacketError::NONE) {
+			audioPacketsMalformed++;
+			logger.warn("Dropped audio packet of %d B: %s.", length, AudioPacket::GetErrorString(error));
+			return;
+		}
+
+		//echo of our own UDP ping
+		if (audioIncomingPacket.GetHeaderType() == AudioPacketType::Ping) {
+			if (udp) {
+				processUdpPing(static_cast<uint64_t>(audioIncomingPacket.GetPingTimestamp()));
+			}
+			return;
+		}
+
+		audioPacketsReceived++;
+		audioIncomingPacket.SetReceiveTime(arrival, kernel);
+
+		//a corrupt frame from one speaker must not end the session
+		try {
+			processEncodedAudioPacketFunction(audioIncomingPacket);
+		}
+		catch (const AudioDecoderException& ex) {
+			audioPacketsUndecodable++;
+			logger.warn("Dropped undecodable audio packet: %s.", ex.what());
+		}
+	}
+
+	void Transport::getStatistics(Statistics& statistics) const {
+		statistics.audio_packets_received = audioPacketsReceived;
+		statistics.audio_packets_malformed = audioPacketsMalformed;
+		statistics.audio_packets_undecodable = audioPacketsUndecodable;
+		statistics.udp_packets_decrypt_failed = udpPacketsDecryptFailed;
+		statistics.udp_packets_dropped = udpPacketsDropped;
+		statistics.udp_active = udpActive;
+		statistics.udp_fallbacks = udpFallbacks;
+		statistics.udp_recoveries = udpRecoveries;
+		statistics.udp_pings_sent = udpPingsSent;
+		statistics.udp_pings_received = udpPingsReceived;
+		statistics.udp_ping_rtt_ms = udpPingRttMs;
+		statistics.tcp_ping_rtt_ms = tcpPingRttMs;
+		statistics.reconnects = reconnects;
+		statistics.tls_sessions_resumed = tlsSessionsResumed;
+		statistics.udp_kernel_drops = udpKernelDrops;
+		statistics.crypt_resync_requests = cryptResyncRequests;
+		statistics.crypt_resyncs = cryptResyncs;
+		statistics.io_deadline_misses = ioDeadlineMisses;
+		statistics.io_lateness_max_us = ioLatenessMaxUs;
+		statistics.udp_receive_delay_us = udpReceiveDelayUs;
+		statistics.udp_receive_delay_max_us = udpReceiveDelayMaxUs;
+		statistics.time_to_server_sync_ms = timeToServerSyncMs;
+	}
+
 	void Transport::sendUdpPing()
 	{
-		auto packet = AudioPacket::CreatePingPacket(time(nullptr)).Encode();
+		//echoed back by the server, used for rtt and loss
+		auto packet = AudioPacket::CreatePingPacket(static_cast<int64_t>(pingTimestamp())).Encode();
 		sendUdpAsync(packet.data(), packet.size());
+
+		udpPingsSent++;
+		udpPingsUnanswered++;
 	}
 
 	void Transport::sendSsl(uint8_t* buff, int length) {
@@ -467,12 +1132,11 @@ namespace mumlib2 {
 		}
 
 		try {
-			write(sslSocket, asio::buffer(buff, static_cast<size_t>(length)));
+			write(*sslSocket, asio::buffer(buff, static_cast<size_t>(length)));
 		}
 		catch (std::system_error& err) {
 			logger.log("Mumlib2::Transport::sendSsl() -> failed to send packet with error #", err.code());
-			disconnect();
-			state = ConnectionState::FAILED;
+			handleError(TransportError::TLS_SEND_FAILED, err.code().message());
 		}
 	}
 
@@ -489,12 +1153,12 @@ namespace mumlib2 {
 		//logger.warn("Sending %d B of data asynchronously.", length);
 
 		async_write(
-			sslSocket,
+			*sslSocket,
 			asio::buffer(asyncBuff, static_cast<size_t>(length)),
 			[this, asyncBuff](const std::error_code& ec, size_t bytesTransferred) {
 				std::free(asyncBuff);
-				if (ec || !bytesTransferred) {
-					throwTransportException("async SSL send failed: " + ec.message());
+				if ((ec || !bytesTransferred) && ec != asio::error::operation_aborted) {
+					handleError(TransportError::TLS_SEND_FAILED, ec.message());
 				}
 			}
 		);
@@ -530,8 +1194,62 @@ namespace mumlib2 {
     free(buff);
 	}
 
+	void Transport::handleError(TransportError error, const std::string& detail) {
+		std::error_code code = error;
+
+		switch (transport_error_policy(error)) {
+		case TransportErrorPolicy::DROP:
+			if (error == TransportError::UDP_DECRYPT_FAILED) {
+				udpPacketsDecryptFailed++;
+			}
+			else {
+				udpPacketsDropped++;
+			}
+			logger.warn("Dropped UDP packet: %s.", code.message().c_str());
+			return;
+
+		case TransportErrorPolicy::FALLBACK_TCP:
+			logger.warn("UDP error: %s %s.", code.message().c_str(), detail.c_str());
+			setUdpActive(false, "UDP error");
+			break;
+
+		case TransportErrorPolicy::CLOSE:
+			//already torn down, late handlers of the closed sockets report here too
+			if (state != ConnectionState::IN_PROGRESS && state != ConnectionState::CONNECTED) {
+				return;
+			}
+
+			logger.error("Connection closed: %s %s.", code.message().c_str(), detail.c_str());
+			lastError = code;
+
+			//a rejected login will be rejected again
+			if (reconnectEnabled && error != TransportError::REJECTED) {
+				closeSockets();
+				scheduleReconnect();
+			}
+			else {
+				disconnect();
+				setState(ConnectionState::FAILED);
+			}
+			break;
+		}
+
+		if (processErrorFunction) {
+			processErrorFunction(code);
+		}
+	}
+
+	void Transport::handleSslReceiveError(const std::error_code& ec) {
+		//cancellation comes from our own disconnect
+		if (ec == asio::error::operation_aborted) {
+			return;
+		}
+
+		handleError(TransportError::TLS_RECEIVE_FAILED, ec.message());
+	}
+
 	void Transport::throwTransportException(std::string message) {
-		state = ConnectionState::FAILED;
+		setState(ConnectionState::FAILED);
 
 		throw TransportException(std::move(message));
 	}
@@ -546,12 +1264,18 @@ namespace mumlib2 {
 			sendUdpAsync(buffer, length);
 		}
 		else {
+			if (length > static_cast<int>(MUMBLE_UDP_MAXLENGTH)) {
+				logger.warn("sendEncodedAudioPacket: %d B does not fit a tunneled datagram.", length);
+				return;
+			}
+
 			const uint16_t netUdptunnelType = htons(static_cast<uint16_t>(MessageType::UDPTUNNEL));
 			const uint32_t netLength = htonl(static_cast<uint32_t>(length));
 
-			const int packet = sizeof(netUdptunnelType) + sizeof(netLength) + length;
-
-			uint8_t packetBuff[MUMBLE_UDP_MAXLENGTH];
+			//a full datagram plus the tunnel prefix, the largest packet accepted for sending has to fit
+			uint8_t packetBuff[UDPTUNNEL_HEADER_LENGTH + MUMBLE_UDP_MAXLENGTH];
+			static_assert(sizeof(packetBuff) >= UDPTUNNEL_HEADER_LENGTH + AUDIO_PACKET_MAX);
+			static_assert(sizeof(netUdptunnelType) + sizeof(netLength) == UDPTUNNEL_HEADER_LENGTH);
 
 			memcpy(packetBuff, &netUdptunnelType, sizeof(netUdptunnelType));
 			memcpy(packetBuff + sizeof(netUdptunnelType), &netLength, sizeof(netLength));
@@ -560,4 +1284,10 @@ namespace mumlib2 {
 			sendSsl(packetBuff, length + sizeof(netUdptunnelType) + sizeof(netLength));
 		}
 	}
+
+	void Transport::postEncodedAudioPacket(std::vector<uint8_t>&& packet) {
+		asio::post(ioService, [this, packet = std::move(packet)]() {
+			sendEncodedAudioPacket(packet.data(), static_cast<int>(packet.size()));
+		});
+	}
 }
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//stdlib
+#include <algorithm>
+#include <cstdlib>
+
+//mumlib
+#include "mumlib2_private/audio_arrival.h"
+
+namespace mumlib2 {
+
+    static uint32_t clampUs(int64_t value)
+    {
+        return static_cast<uint32_t>(std::clamp<int64_t>(value, 0, UINT32_MAX));
+    }
+
+    //
+    // Update
+    //
+
+    void AudioArrival::Update(int32_t session_id, int64_t sequence_number, std::chrono::system_clock::time_point arrival, bool kernel)
+    {
+        int64_t arrival_us = std::chrono::duration_cast<std::chrono::microseconds>(arrival.time_since_epoch()).count();
+        int64_t transit_us = arrival_us - sequence_number * _sequence_us;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto [it, inserted] = _speakers.try_emplace(session_id);
+        Speaker& speaker = it->second;
+        speaker.statistics.session_id = session_id;
+        speaker.statistics.packets++;
+        speaker.statistics.kernel_timestamps = kernel;
+
+        bool spurt = inserted || arrival_us - speaker.arrival_last_us > _spurt_gap.count();
+        speaker.arrival_last_us = arrival_us;
+
+        if (spurt) {
+            //sender clock restarted, transit of the previous spurt is not comparable
+            speaker.sequence_last = sequence_number;
+            speaker.transit_last_us = transit_us;
+            speaker.transit_min_us = transit_us;
+            speaker.transit_us_16 = transit_us * 16;
+            speaker.statistics.delay_trend_us = 0;
+            return;
+        }
+
+        //late or duplicated, its transit would count the reordering twice
+        if (sequence_number <= speaker.sequence_last) {
+            return;
+        }
+
+        int64_t delta = std::abs(transit_us - speaker.transit_last_us);
+        speaker.jitter_us_16 += delta - ((speaker.jitter_us_16 + 8) >> 4);
+        speaker.transit_us_16 += transit_us - ((speaker.transit_us_16 + 8) >> 4);
+        speaker.transit_min_us = std::min(speaker.transit_min_us, transit_us);
+
+        speaker.sequence_last = sequence_number;
+        speaker.transit_last_us = transit_us;
+
+        speaker.statistics.jitter_us = clampUs(speaker.jitter_us_16 >> 4);
+        speaker.statistics.delay_trend_us = clampUs((speaker.transit_us_16 >> 4) - speaker.transit_min_us);
+    }
+
+    void AudioArrival::UpdateProcessing(int32_t session_id, std::chrono::system_clock::duration latency)
+    {
+        uint32_t latency_us = clampUs(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto it = _speakers.find(session_id);
+        if (it == _speakers.end()) {
+            return;
+        }
+
+        auto& statistics = it->second.statistics;
+        uint32_t average = statistics.processing_latency_us;
+        statistics.processing_latency_us = average ? (average * 7 + latency_us) / 8 : std::max(latency_us, 1u);
+        statistics.processing_latency_max_us = std::max(statistics.processing_latency_max_us, latency_us);
+    }
+
+    //
+    // Removal
+    //
+
+    void AudioArrival::Erase(int32_t session_id)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _speakers.erase(session_id);
+    }
+
+    void AudioArrival::Clear()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _speakers.clear();
+    }
+
+    //
+    // Result
+    //
+
+    std::vector<SpeakerStatistics> AudioArrival::Get() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        std::vector<SpeakerStatistics> result;
+        result.reserve(_speakers.size());
+        for (const auto& [session_id, speaker] : _speakers) {
+            result.push_back(speaker.statistics);
+        }
+        return result;
+    }
+}
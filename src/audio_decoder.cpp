@@ -16,15 +16,59 @@ namespace mumlib2 {
     // Ctor/Dtor
     //
 
-    AudioDecoder::AudioDecoder(uint32_t channels)
+    AudioDecoder::AudioDecoder(uint32_t channels, uint32_t output_samplerate, ResamplerQuality quality, AudioSampleFormat format, AudioPanner* panner)
     {
+        _panner = panner;
         _channels = channels;
+        _output_samplerate = output_samplerate;
+        _resampler_quality = quality;
+        _format = format;
     }
 
     AudioDecoder::~AudioDecoder() {
     }
 
     std::pair<const int16_t*, size_t> AudioDecoder::Process(const AudioPacket& packet)
+    {
+        return sessionGet(packet.GetAudioSessionId()).Process(packet);
+    }
+
+    std::pair<const float*, size_t> AudioDecoder::ProcessFloat(const AudioPacket& packet)
+    {
+        return sessionGet(packet.GetAudioSessionId()).ProcessFloat(packet);
+    }
+
+    size_t AudioDecoder::ProcessInto(const AudioPacket& packet, int16_t* output, size_t output_frames)
+    {
+        return sessionGet(packet.GetAudioSessionId()).ProcessInto(packet, output, output_frames);
+    }
+
+    size_t AudioDecoder::ProcessInto(const AudioPacket& packet, float* output, size_t output_frames)
+    {
+        return sessionGet(packet.GetAudioSessionId()).ProcessInto(packet, output, output_frames);
+    }
+
+    size_t AudioDecoder::GetOutputLength(const AudioPacket& packet)
+    {
+        return sessionGet(packet.GetAudioSessionId()).GetOutputLength(packet);
+    }
+
+    uint32_t AudioDecoder::GetChannels() const
+    {
+        return _channels;
+    }
+
+    AudioSampleFormat AudioDecoder::GetFormat() const
+    {
+        return _format;
+    }
+
+    uint32_t AudioDecoder::GetSamplerate() const
+    {
+        return _output_samplerate;
+    }
+
+    AudioDecoderSession& AudioDecoder::sessionGet(int32_t session_id)
     {
         //cleanup
         auto current_time = std::chrono::steady_clock::now();
@@ -38,12 +82,20 @@ namespace mumlib2 {
             }
         }
 
-        //process
-        auto session_id = packet.GetAudioSessionId();
+        //create
         if (!_sessions.contains(session_id)) {
-            _sessions.emplace(session_id, std::make_unique<AudioDecoderSession>(session_id, _channels));
+            _sessions.emplace(session_id, std::make_unique<AudioDecoderSession>(session_id, _channels, _output_samplerate, _resampler_quality, _format, _panner));
         }
 
-        return _sessions[session_id]->Process(packet);
+        return *_sessions[session_id];
+    }
+
+    void AudioDecoder::Skip(const AudioPacket& packet)
+    {
+        //sessions are only created once decoding is needed
+        auto it = _sessions.find(packet.GetAudioSessionId());
+        if (it != _sessions.end()) {
+            it->second->Skip();
+        }
     }
 }
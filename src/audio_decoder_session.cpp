@@ -5,12 +5,23 @@
 #include "mumlib2/constants.h"
 #include "mumlib2/exceptions.h"
 #include "mumlib2_private/audio_decoder_session.h"
+#include "mumlib2_private/tracer.h"
 
 namespace mumlib2 {
-	AudioDecoderSession::AudioDecoderSession(int32_t session_id, uint32_t channels)
+	AudioDecoderSession::AudioDecoderSession(int32_t session_id, uint32_t channels, uint32_t output_samplerate, ResamplerQuality quality, AudioSampleFormat format, AudioPanner* panner)
 	{
 		_session_id = session_id;
 		_channels = channels;
+		_format = format;
+
+		//panning needs a stereo output
+		if (_channels == 2) {
+			_panner = panner;
+		}
+
+		if (output_samplerate != MUMBLE_AUDIO_SAMPLERATE) {
+			_resampler = std::make_unique<Resampler>(MUMBLE_AUDIO_SAMPLERATE, output_samplerate, _channels, quality);
+		}
 
 		opusCreate();
 		opusResize();
@@ -37,13 +48,32 @@ namespace mumlib2 {
 		}
 	}
 
-	size_t AudioDecoderSession::opusDecode(const uint8_t* in_data, size_t in_len)
+	size_t AudioDecoderSession::opusDecode(const uint8_t* in_data, size_t in_len, int16_t* out_data, size_t out_len)
 	{
 		if (!_opus) {
 			throw AudioDecoderException("opusDecode: no decoder");
 		}
 
-		return opus_decode(_opus, in_data, in_len, _opus_output_buf.data(), static_cast<int>(_opus_output_buf.size()), 0);
+		int result = opus_decode(_opus, in_data, in_len, out_data, static_cast<int>(out_len / _channels), 0);
+		if (result < 0) {
+			return 0;
+		}
+
+		return result;
+	}
+
+	size_t AudioDecoderSession::opusDecode(const uint8_t* in_data, size_t in_len, float* out_data, size_t out_len)
+	{
+		if (!_opus) {
+			throw AudioDecoderException("opusDecode: no decoder");
+		}
+
+		int result = opus_decode_float(_opus, in_data, in_len, out_data, static_cast<int>(out_len / _channels), 0);
+		if (result < 0) {
+			return 0;
+		}
+
+		return result;
 	}
 
 	void AudioDecoderSession::opusDestroy()
@@ -56,10 +86,19 @@ namespace mumlib2 {
 
 	void AudioDecoderSession::opusResize()
 	{
-		size_t target_size = MUMBLE_AUDIO_SAMPLERATE * MUMBLE_AUDIO_CHANNELS * MUMBLE_OPUS_MAXLENGTH / 1000;
-		if (_opus_output_buf.size() != target_size) {
+		//opus upmixes mono streams when more output channels are requested
+		size_t target_size = MUMBLE_AUDIO_SAMPLERATE * _channels * MUMBLE_OPUS_MAXLENGTH / 1000;
+		size_t resampler_size = _resampler ? _resampler->GetOutputLength(target_size / _channels) * _channels : 0;
+
+		//only the buffers of the selected format are allocated
+		if (_format == AudioSampleFormat::FLOAT32) {
+			_opus_output_float.resize(target_size);
+			_resampler_output_float.resize(resampler_size);
+		}
+		else {
 			_opus_output_buf.resize(target_size);
-		};
+			_resampler_output_buf.resize(resampler_size);
+		}
 	}
 
 	void AudioDecoderSession::reset()
@@ -74,28 +113,128 @@ namespace mumlib2 {
 		}
 	}
 
+	void AudioDecoderSession::Skip()
+	{
+		_stale = true;
+		_timepoint_last = std::chrono::steady_clock::now();
+	}
+
 	std::pair<const int16_t*, size_t> AudioDecoderSession::Process(const AudioPacket& packet)
 	{
-		int16_t* result_data = nullptr;
+		auto& output = _resampler ? _resampler_output_buf : _opus_output_buf;
+		return std::make_pair(output.data(), process(packet, output.data(), output.size() / _channels, _opus_output_buf));
+	}
+
+	std::pair<const float*, size_t> AudioDecoderSession::ProcessFloat(const AudioPacket& packet)
+	{
+		auto& output = _resampler ? _resampler_output_float : _opus_output_float;
+		return std::make_pair(output.data(), process(packet, output.data(), output.size() / _channels, _opus_output_float));
+	}
+
+	size_t AudioDecoderSession::ProcessInto(const AudioPacket& packet, int16_t* output, size_t output_frames)
+	{
+		return process(packet, output, output_frames, _opus_output_buf);
+	}
+
+	size_t AudioDecoderSession::ProcessInto(const AudioPacket& packet, float* output, size_t output_frames)
+	{
+		return process(packet, output, output_frames, _opus_output_float);
+	}
+
+	size_t AudioDecoderSession::GetOutputLength(const AudioPacket& packet) const
+	{
+		auto& payload = packet.GetAudioPayload();
+		if (payload.empty()) {
+			return 0;
+		}
+
+		int frames = opus_packet_get_nb_samples(payload.data(), static_cast<opus_int32>(payload.size()), MUMBLE_AUDIO_SAMPLERATE);
+		if (frames <= 0) {
+			return 0;
+		}
+
+		return _resampler ? _resampler->GetOutputLength(frames) : frames;
+	}
+
+	template <typename T>
+	void AudioDecoderSession::pan(const AudioPacket& packet, T* output, size_t output_frames)
+	{
+		//sources without position stay centered at full volume
+		std::pair<float, float> gains{ 1.0f, 1.0f };
+		if (packet.GetAudioHasPosition()) {
+			gains = _panner->GetGains(packet.GetAudioPosition());
+		}
+
+		//ramp from the previous gains over the frame to avoid clicks on movement
+		float step_left = (gains.first - _pan_gains.first) / output_frames;
+		float step_right = (gains.second - _pan_gains.second) / output_frames;
+		for (size_t frame = 0; frame < output_frames; frame++) {
+			float gain_left = _pan_gains.first + step_left * (frame + 1);
+			float gain_right = _pan_gains.second + step_right * (frame + 1);
+
+			//gains never exceed 1, so int16 samples cannot overflow
+			output[frame * 2] = static_cast<T>(output[frame * 2] * gain_left);
+			output[frame * 2 + 1] = static_cast<T>(output[frame * 2 + 1] * gain_right);
+		}
+
+		_pan_gains = gains;
+	}
+
+	template <typename T>
+	size_t AudioDecoderSession::process(const AudioPacket& packet, T* output, size_t output_frames, std::vector<T>& opus_buf)
+	{
+		MUMLIB2_TRACE_SCOPE("AudioDecoderSession::process", DECODER);
+
+		if (opus_buf.empty()) {
+			throw AudioDecoderException("process: sample format does not match the session");
+		}
+
 		size_t result_size = 0;
 
+		//skipped packets left the decoder mid-stream
+		if (_stale) {
+			_stale = false;
+			reset();
+
+			if (_resampler) {
+				_resampler->Reset();
+			}
+		}
+
 		auto& payload = packet.GetAudioPayload();
 		if (payload.size()) {
-			result_size = opusDecode(payload.data(), payload.size());
-			result_data = _opus_output_buf.data();
+			//without resampling opus writes straight into the output
+			if (_resampler) {
+				result_size = opusDecode(payload.data(), payload.size(), opus_buf.data(), opus_buf.size());
+			}
+			else {
+				result_size = opusDecode(payload.data(), payload.size(), output, output_frames * _channels);
+			}
 
 			if (result_size <= 0) {
 				throw AudioDecoderException("failed to decode opus data");
 			}
+
+			if (_resampler) {
+				result_size = _resampler->Process(opus_buf.data(), result_size, output, output_frames);
+			}
+
+			if (_panner && result_size) {
+				pan(packet, output, result_size);
+			}
 		}
 
 		//reset
 		if (packet.GetAudioLastFlag()) {
 			reset();
+
+			if (_resampler) {
+				_resampler->Reset();
+			}
 		}
 
 		_timepoint_last = std::chrono::steady_clock::now();
 
-		return std::make_pair(result_data, result_size);
+		return result_size;
 	}
 }
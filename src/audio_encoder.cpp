@@ -1,6 +1,8 @@
 //stdlib
+#include <algorithm>
 #include <array>
 #include <chrono>
+#include <cstring>
 
 //mumlib
 #include "mumlib2/constants.h"
@@ -13,13 +15,26 @@ namespace mumlib2 {
     // Ctor/Dtor
     //
 
-    AudioEncoder::AudioEncoder(uint32_t output_bitrate) {
+    AudioEncoder::AudioEncoder(uint32_t input_samplerate, uint32_t output_bitrate, ResamplerQuality quality, const AudioEncoderProfile& profile)
+        : _profile(profile), _input(input_samplerate * MUMBLE_AUDIO_CHANNELS)
+    {
         _channels = MUMBLE_AUDIO_CHANNELS;
 
+        //10 ms chunks of input are fed to the resampler
+        _input_buf.resize(input_samplerate / 100 * _channels);
+        if (input_samplerate != MUMBLE_AUDIO_SAMPLERATE) {
+            _resampler = std::make_unique<Resampler>(input_samplerate, MUMBLE_AUDIO_SAMPLERATE, _channels, quality);
+        }
+
         createOpus();
 
+        applyProfile();
+
         SetBitrate(output_bitrate);
 
+        applyBitrate();
+        applyFrameDuration();
+
         reset();
     }
 
@@ -31,11 +46,28 @@ namespace mumlib2 {
     {
         destroyOpus();
 
+        int application = OPUS_APPLICATION_VOIP;
+        switch (_profile.application) {
+        case AudioApplication::AUDIO:
+            application = OPUS_APPLICATION_AUDIO;
+            break;
+        case AudioApplication::LOW_DELAY:
+            application = OPUS_APPLICATION_RESTRICTED_LOWDELAY;
+            break;
+        default:
+            break;
+        }
+
         int status = 0;
-        _encoder = opus_encoder_create(MUMBLE_AUDIO_SAMPLERATE, _channels, OPUS_APPLICATION_VOIP, &status);
+        _encoder = opus_encoder_create(MUMBLE_AUDIO_SAMPLERATE, _channels, application, &status);
         if (status != OPUS_OK) {
             throw AudioEncoderException(std::string("failed to initialize OPUS encoder: ") + opus_strerror(status));
         }
+
+        _repacketizer = opus_repacketizer_create();
+        if (!_repacketizer) {
+            throw AudioEncoderException("failed to initialize OPUS repacketizer");
+        }
     }
 
     void AudioEncoder::destroyOpus()
@@ -44,6 +76,61 @@ namespace mumlib2 {
             opus_encoder_destroy(_encoder);
             _encoder = nullptr;
         }
+
+        if (_repacketizer) {
+            opus_repacketizer_destroy(_repacketizer);
+            _repacketizer = nullptr;
+        }
+    }
+
+    void AudioEncoder::applyProfile()
+    {
+        int signal = OPUS_AUTO;
+        if (_profile.signal == AudioSignal::VOICE) {
+            signal = OPUS_SIGNAL_VOICE;
+        }
+        else if (_profile.signal == AudioSignal::MUSIC) {
+            signal = OPUS_SIGNAL_MUSIC;
+        }
+
+        int bandwidth = OPUS_BANDWIDTH_FULLBAND;
+        switch (_profile.max_bandwidth) {
+        case AudioBandwidth::NARROWBAND:
+            bandwidth = OPUS_BANDWIDTH_NARROWBAND;
+            break;
+        case AudioBandwidth::MEDIUMBAND:
+            bandwidth = OPUS_BANDWIDTH_MEDIUMBAND;
+            break;
+        case AudioBandwidth::WIDEBAND:
+            bandwidth = OPUS_BANDWIDTH_WIDEBAND;
+            break;
+        case AudioBandwidth::SUPERWIDEBAND:
+            bandwidth = OPUS_BANDWIDTH_SUPERWIDEBAND;
+            break;
+        default:
+            break;
+        }
+
+        int error = opus_encoder_ctl(_encoder, OPUS_SET_VBR(_profile.bitrate_mode == AudioBitrateMode::CBR ? 0 : 1));
+        if (error == OPUS_OK) {
+            error = opus_encoder_ctl(_encoder, OPUS_SET_VBR_CONSTRAINT(_profile.bitrate_mode == AudioBitrateMode::CVBR ? 1 : 0));
+        }
+        if (error == OPUS_OK) {
+            error = opus_encoder_ctl(_encoder, OPUS_SET_COMPLEXITY(_profile.complexity));
+        }
+        if (error == OPUS_OK) {
+            error = opus_encoder_ctl(_encoder, OPUS_SET_DTX(_profile.dtx ? 1 : 0));
+        }
+        if (error == OPUS_OK) {
+            error = opus_encoder_ctl(_encoder, OPUS_SET_SIGNAL(signal));
+        }
+        if (error == OPUS_OK) {
+            error = opus_encoder_ctl(_encoder, OPUS_SET_MAX_BANDWIDTH(bandwidth));
+        }
+
+        if (error != OPUS_OK) {
+            throw AudioEncoderException(std::string("failed to apply encoder profile: ") + opus_strerror(error));
+        }
     }
 
     void AudioEncoder::reset() {
@@ -56,74 +143,290 @@ namespace mumlib2 {
             throw AudioEncoderException(std::string("failed to reset OPUS encoder: ") + opus_strerror(status));
         }
 
+        opus_repacketizer_init(_repacketizer);
+        _packet_frames = 0;
+
+        //partial frame and resampler history belong to the previous stream
+        _frame_fill = 0;
+        if (_resampler) {
+            _resampler->Reset();
+        }
+
         _sequence_number = 0;
     }
 
     void AudioEncoder::SetBitrate(uint32_t bitrate)
     {
-        _encoder_buf.resize(bitrate * MUMBLE_OPUS_MAXLENGTH / 1000);
+        _bitrate_requested = bitrate;
+    }
 
-        if (!_encoder) {
-            throw AudioEncoderException("failed to reset encoder");
+    void AudioEncoder::applyBitrate()
+    {
+        uint32_t bitrate = _bitrate_requested;
+        if (bitrate == _bitrate) {
+            return;
         }
 
-        int error = opus_encoder_ctl(_encoder, OPUS_SET_VBR(0));
+        int error = opus_encoder_ctl(_encoder, OPUS_SET_BITRATE(bitrate));
         if (error != OPUS_OK) {
-            throw AudioEncoderException(std::string("failed to initialize variable bitrate:") + opus_strerror(error));
+            throw AudioEncoderException(std::string("failed to initialize transmission bitrate:") + opus_strerror(error));
         }
 
-        error = opus_encoder_ctl(_encoder, OPUS_SET_BITRATE(bitrate));
-        if (error != OPUS_OK) {
-            throw AudioEncoderException(std::string("failed to initialize transmission bitrate:") + opus_strerror(error));
+        _bitrate = bitrate;
+    }
+
+    bool AudioEncoder::SetFrameDuration(uint32_t frame_duration_ms, uint32_t frames_per_packet)
+    {
+        //sequence numbers count 10 ms units and the receiving side buffers at most MUMBLE_OPUS_MAXLENGTH per packet
+        if (frame_duration_ms != 10 && frame_duration_ms != 20 && frame_duration_ms != 40 && frame_duration_ms != 60) {
+            return false;
         }
+        if (!frames_per_packet || frame_duration_ms * frames_per_packet > MUMBLE_OPUS_MAXLENGTH) {
+            return false;
+        }
+
+        _frame_duration_requested = frame_duration_ms;
+        _frames_per_packet_requested = frames_per_packet;
+        return true;
     }
 
-    std::vector<uint8_t> AudioEncoder::Encode(const int16_t* pcmData, size_t pcmLength, uint32_t target) {
-        const int16_t* in_data = pcmData;
-        int in_len = pcmLength;
+    void AudioEncoder::Flush()
+    {
+        _flush_requested = true;
+    }
+
+    void AudioEncoder::SetPosition(const std::optional<std::array<float, 3>>& position)
+    {
+        std::lock_guard<std::mutex> lock(_position_mutex);
+        _position = position;
+    }
 
-        int out_len = 0;
+    std::chrono::milliseconds AudioEncoder::GetPacketDuration() const
+    {
+        return std::chrono::milliseconds(_frame_duration_requested * _frames_per_packet_requested);
+    }
 
-        //check interval and reset encoder
-        auto interval = std::chrono::high_resolution_clock::now() - _sequence_timestemp;
-        if (interval > _sequence_reset_interval) {
-            reset();
+    //
+    // Input
+    //
+
+    size_t AudioEncoder::Push(const int16_t* pcmData, size_t pcmLength)
+    {
+        if (!pcmData || !pcmLength) {
+            return 0;
+        }
+
+        _push_timestemp = std::chrono::high_resolution_clock::now();
+
+        auto written = _input.Write(pcmData, pcmLength);
+        if (written != pcmLength) {
+            logger.warn("AudioEncoder::Push() -> input buffer overflow, dropped %d samples", pcmLength - written);
+        }
+
+        return written;
+    }
+
+    void AudioEncoder::applyFrameDuration()
+    {
+        uint32_t frame_duration = _frame_duration_requested;
+        uint32_t frames_per_packet = _frames_per_packet_requested;
+        if (frame_duration == _frame_duration && frames_per_packet == _frames_per_packet) {
+            return;
+        }
+
+        //never cut already accumulated audio
+        size_t frame_length = MUMBLE_AUDIO_SAMPLERATE / 1000 * frame_duration * _channels;
+        if (_frame_fill > frame_length) {
+            return;
+        }
+
+        _frame_duration = frame_duration;
+        _frames_per_packet = frames_per_packet;
+        _frame_buf.resize(frame_length);
+
+        //every frame has its own slot because the repacketizer keeps pointers until the packet is emitted,
+        //code 3 packets need 2 bytes of header plus up to 2 length bytes per frame
+        _encoder_frame_max = (_encoder_packet_max - 2 - 2 * (_frames_per_packet - 1)) / _frames_per_packet;
+        _encoder_buf.resize(_encoder_frame_max * _frames_per_packet);
+        _packet_buf.resize(_encoder_packet_max);
+    }
+
+    bool AudioEncoder::fillFrame()
+    {
+        while (_frame_fill < _frame_buf.size()) {
+            size_t needed = (_frame_buf.size() - _frame_fill) / _channels;
+
+            if (_resampler) {
+                //drain what the resampler still holds before feeding more input
+                _frame_fill += _resampler->Process(nullptr, 0, &_frame_buf[_frame_fill], needed) * _channels;
+                if (_frame_fill == _frame_buf.size()) {
+                    break;
+                }
+
+                auto read = _input.Read(_input_buf.data(), _input_buf.size()) / _channels;
+                if (!read) {
+                    break;
+                }
+
+                needed = (_frame_buf.size() - _frame_fill) / _channels;
+                _frame_fill += _resampler->Process(_input_buf.data(), read, &_frame_buf[_frame_fill], needed) * _channels;
+            }
+            else {
+                auto read = _input.Read(&_frame_buf[_frame_fill], needed * _channels);
+                if (!read) {
+                    break;
+                }
+
+                _frame_fill += read;
+            }
         }
-        
-        //resample and encode
-        if (pcmData && pcmLength) {
-            out_len = opus_encode(
-                _encoder,
-                in_data,
-                in_len,
-                _encoder_buf.data(),
-                _encoder_buf.size()
-            );
-
-            if (out_len <= 0) {
-                throw AudioEncoderException(std::string("failed to encode PCM data: %s") + opus_strerror(out_len));
+
+        return _frame_fill == _frame_buf.size();
+    }
+
+    //
+    // Encode
+    //
+
+    std::vector<uint8_t> AudioEncoder::EncodeNext(uint32_t target) {
+        if (_packet_frames == 0) {
+            applyBitrate();
+            applyFrameDuration();
+
+            //check interval and reset encoder
+            auto now = std::chrono::high_resolution_clock::now();
+            if (now - _sequence_timestemp > _sequence_reset_interval) {
+                reset();
+
+                //input pushed after the pause already starts the next stream
+                if (now - _push_timestemp.load() > _sequence_reset_interval) {
+                    _input.Clear();
+                }
             }
         }
 
-        //create audiopacket
-        auto encoded = AudioPacket::CreateAudioOpusPacket(
-            target,
-            _sequence_number,
-            _encoder_buf.data(),
-            out_len,
-            out_len == 0).Encode();
+        while (fillFrame()) {
+            auto packet = encodeFrame(target, false);
+            if (!packet.empty()) {
+                return packet;
+            }
+        }
 
-        //update timestamp and sequence
-        if (out_len > 0) {
-            //1 per 10ms
-            _sequence_number += 100 * in_len / MUMBLE_AUDIO_SAMPLERATE;
+        //queued input is used up, close the stream if asked to
+        if (_flush_requested) {
+            return flush(target);
         }
-        else {
-            reset();
+
+        return {};
+    }
+
+    std::vector<uint8_t> AudioEncoder::encodeFrame(uint32_t target, bool last)
+    {
+        _frame_fill = 0;
+
+        uint8_t* frame_data = &_encoder_buf[_packet_frames * _encoder_frame_max];
+        int out_len = opus_encode(
+            _encoder,
+            _frame_buf.data(),
+            static_cast<int>(_frame_buf.size() / _channels),
+            frame_data,
+            static_cast<opus_int32>(_encoder_frame_max)
+        );
+
+        if (out_len <= 0) {
+            throw AudioEncoderException(std::string("failed to encode PCM data: ") + opus_strerror(out_len));
         }
 
         _sequence_timestemp = std::chrono::high_resolution_clock::now();
 
+        //single frame packets need no repacketization
+        if (_frames_per_packet == 1) {
+            return createPacket(target, frame_data, out_len, last);
+        }
+
+        std::vector<uint8_t> flushed;
+        if (opus_repacketizer_cat(_repacketizer, frame_data, out_len) != OPUS_OK) {
+            //encoder switched mode mid-packet, emit collected frames and start over with this one
+            auto packet_len = opus_repacketizer_out(_repacketizer, _packet_buf.data(), static_cast<opus_int32>(_packet_buf.size()));
+            if (packet_len > 0) {
+                flushed = createPacket(target, _packet_buf.data(), packet_len, false);
+            }
+
+            std::memmove(_encoder_buf.data(), frame_data, out_len);
+            opus_repacketizer_init(_repacketizer);
+            opus_repacketizer_cat(_repacketizer, _encoder_buf.data(), out_len);
+            _packet_frames = 0;
+        }
+        _packet_frames++;
+
+        if (!flushed.empty()) {
+            return flushed;
+        }
+
+        if (_packet_frames == _frames_per_packet || last) {
+            return repacketize(target, last);
+        }
+
+        return {};
+    }
+
+    std::vector<uint8_t> AudioEncoder::repacketize(uint32_t target, bool last)
+    {
+        auto packet_len = opus_repacketizer_out(_repacketizer, _packet_buf.data(), static_cast<opus_int32>(_packet_buf.size()));
+        opus_repacketizer_init(_repacketizer);
+
+        if (packet_len <= 0) {
+            _packet_frames = 0;
+            throw AudioEncoderException(std::string("failed to repacketize OPUS frames: ") + opus_strerror(packet_len));
+        }
+
+        return createPacket(target, _packet_buf.data(), packet_len, last);
+    }
+
+    std::vector<uint8_t> AudioEncoder::flush(uint32_t target)
+    {
+        std::vector<uint8_t> packet;
+        if (_frame_fill == 0 && _packet_frames > 0) {
+            //frame left over by a mode switch
+            packet = repacketize(target, true);
+        }
+        else if (_frame_fill > 0 || _sequence_number > 0) {
+            //pad the partial frame, a stream ending on a frame boundary gets a silent terminator
+            std::fill(_frame_buf.begin() + _frame_fill, _frame_buf.end(), 0);
+            packet = encodeFrame(target, true);
+        }
+
+        //a mode switch may still hold the last frame back for the next call
+        if (_packet_frames == 0) {
+            _flush_requested = false;
+            reset();
+        }
+
+        return packet;
+    }
+
+    std::vector<uint8_t> AudioEncoder::createPacket(uint32_t target, const uint8_t* payload, size_t payload_len, bool last)
+    {
+        auto frames = std::max(_packet_frames, 1u);
+
+        std::optional<std::array<float, 3>> position;
+        {
+            std::lock_guard<std::mutex> lock(_position_mutex);
+            position = _position;
+        }
+
+        auto encoded = AudioPacket::CreateAudioOpusPacket(
+            target,
+            _sequence_number,
+            payload,
+            payload_len,
+            last,
+            position).Encode();
+
+        //1 per 10ms
+        _sequence_number += frames * _frame_duration / 10;
+        _packet_frames = 0;
+
         return encoded;
     }
 }
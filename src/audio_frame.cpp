@@ -0,0 +1,342 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//stdlib
+#include <algorithm>
+#include <new>
+
+//mumlib
+#include "mumlib2/audio_frame.h"
+#include "mumlib2/constants.h"
+
+namespace mumlib2 {
+
+    //samples start on a cache line, blocks are multiples of it
+    static constexpr size_t audio_frame_alignment = 64;
+
+    static constexpr size_t alignUp(size_t value)
+    {
+        return (value + audio_frame_alignment - 1) / audio_frame_alignment * audio_frame_alignment;
+    }
+
+    static size_t sampleSize(AudioSampleFormat format)
+    {
+        return format == AudioSampleFormat::FLOAT32 ? sizeof(float) : sizeof(int16_t);
+    }
+
+    //
+    // AudioFramePool
+    //
+
+    AudioFramePool::AudioFramePool(size_t block_count, size_t block_size)
+    {
+        if (!block_size) {
+            block_size = AudioFrame::GetAllocationSize(AudioSampleFormat::FLOAT32, 2, MUMBLE_AUDIO_SAMPLERATE / 1000 * 20);
+        }
+
+        _block_size = alignUp(block_size);
+        _block_count = block_count;
+
+        _storage = static_cast<uint8_t*>(::operator new(_block_size * _block_count, std::align_val_t(audio_frame_alignment)));
+        _used = std::make_unique<std::atomic<bool>[]>(_block_count);
+    }
+
+    AudioFramePool::~AudioFramePool()
+    {
+        ::operator delete(_storage, std::align_val_t(audio_frame_alignment));
+    }
+
+    void* AudioFramePool::Allocate(size_t size)
+    {
+        if (size <= _block_size) {
+            //start where the last claim succeeded, neighbours are most likely free
+            size_t start = _hint.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < _block_count; i++) {
+                size_t index = (start + i) % _block_count;
+
+                bool expected = false;
+                if (_used[index].compare_exchange_strong(expected, true, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    _hint.store(index + 1, std::memory_order_relaxed);
+                    return _storage + index * _block_size;
+                }
+            }
+        }
+
+        //runs on the io thread, an empty frame lets the caller fall back to the copying callback
+        return ::operator new(size, std::align_val_t(audio_frame_alignment), std::nothrow);
+    }
+
+    void AudioFramePool::Deallocate(void* ptr, size_t size)
+    {
+        auto* block = static_cast<uint8_t*>(ptr);
+        if (block >= _storage && block < _storage + _block_size * _block_count) {
+            _used[(block - _storage) / _block_size].store(false, std::memory_order_release);
+            return;
+        }
+
+        ::operator delete(ptr, std::align_val_t(audio_frame_alignment));
+    }
+
+    size_t AudioFramePool::GetBlockSize() const
+    {
+        return _block_size;
+    }
+
+    size_t AudioFramePool::GetBlockCount() const
+    {
+        return _block_count;
+    }
+
+    //
+    // AudioFrame
+    //
+
+    struct AudioFrame::Header {
+        std::atomic<uint32_t> references = 1;
+        std::shared_ptr<AudioFrameAllocator> allocator;
+        size_t allocation_size = 0;
+
+        AudioSampleFormat format = AudioSampleFormat::INT16;
+        uint32_t channels = 0;
+        uint32_t samplerate = 0;
+        size_t capacity = 0;
+        size_t frames = 0;
+
+        uint32_t target = 0;
+        int32_t session_id = 0;
+        int64_t sequence_number = 0;
+        bool is_last = false;
+
+        bool has_position = false;
+        std::array<float, 3> position{};
+    };
+
+    AudioFrame::AudioFrame(Header* header) : _header(header)
+    {
+    }
+
+    AudioFrame::AudioFrame(const AudioFrame& other) : _header(other._header)
+    {
+        if (_header) {
+            _header->references.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    AudioFrame::AudioFrame(AudioFrame&& other) noexcept : _header(other._header)
+    {
+        other._header = nullptr;
+    }
+
+    AudioFrame& AudioFrame::operator=(const AudioFrame& other)
+    {
+        if (this != &other) {
+            if (other._header) {
+                other._header->references.fetch_add(1, std::memory_order_relaxed);
+            }
+            release();
+            _header = other._header;
+        }
+        return *this;
+    }
+
+    AudioFrame& AudioFrame::operator=(AudioFrame&& other) noexcept
+    {
+        if (this != &other) {
+            release();
+            _header = other._header;
+            other._header = nullptr;
+        }
+        return *this;
+    }
+
+    AudioFrame::~AudioFrame()
+    {
+        release();
+    }
+
+    void AudioFrame::release()
+    {
+        if (!_header) {
+            return;
+        }
+
+        if (_header->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            //allocator must outlive the header that references it
+            auto allocator = std::move(_header->allocator);
+            auto allocation_size = _header->allocation_size;
+
+            _header->~Header();
+            allocator->Deallocate(_header, allocation_size);
+        }
+
+        _header = nullptr;
+    }
+
+    AudioFrame AudioFrame::Create(std::shared_ptr<AudioFrameAllocator> allocator, AudioSampleFormat format, uint32_t channels, uint32_t samplerate, size_t capacity)
+    {
+        if (!allocator) {
+            return {};
+        }
+
+        size_t allocation_size = GetAllocationSize(format, channels, capacity);
+        void* memory = nullptr;
+        try {
+            memory = allocator->Allocate(allocation_size);
+        }
+        catch (const std::bad_alloc&) {
+            //application allocators may still throw
+        }
+        if (!memory) {
+            return {};
+        }
+
+        auto* header = new (memory) Header();
+        header->allocator = std::move(allocator);
+        header->allocation_size = allocation_size;
+        header->format = format;
+        header->channels = channels;
+        header->samplerate = samplerate;
+        header->capacity = capacity;
+
+        return AudioFrame(header);
+    }
+
+    size_t AudioFrame::GetAllocationSize(AudioSampleFormat format, uint32_t channels, size_t capacity)
+    {
+        return alignUp(sizeof(Header)) + capacity * channels * sampleSize(format);
+    }
+
+    AudioFrame::operator bool() const
+    {
+        return _header != nullptr;
+    }
+
+    uint8_t* AudioFrame::data() const
+    {
+        return reinterpret_cast<uint8_t*>(_header) + alignUp(sizeof(Header));
+    }
+
+    //
+    // Shape
+    //
+
+    AudioSampleFormat AudioFrame::GetFormat() const
+    {
+        return _header ? _header->format : AudioSampleFormat::INT16;
+    }
+
+    uint32_t AudioFrame::GetChannels() const
+    {
+        return _header ? _header->channels : 0;
+    }
+
+    uint32_t AudioFrame::GetSamplerate() const
+    {
+        return _header ? _header->samplerate : 0;
+    }
+
+    size_t AudioFrame::GetCapacity() const
+    {
+        return _header ? _header->capacity : 0;
+    }
+
+    size_t AudioFrame::GetFrames() const
+    {
+        return _header ? _header->frames : 0;
+    }
+
+    void AudioFrame::SetFrames(size_t frames)
+    {
+        if (_header) {
+            _header->frames = std::min(frames, _header->capacity);
+        }
+    }
+
+    //
+    // Stream
+    //
+
+    uint32_t AudioFrame::GetTarget() const
+    {
+        return _header ? _header->target : 0;
+    }
+
+    int32_t AudioFrame::GetSessionId() const
+    {
+        return _header ? _header->session_id : 0;
+    }
+
+    int64_t AudioFrame::GetSequenceNumber() const
+    {
+        return _header ? _header->sequence_number : 0;
+    }
+
+    bool AudioFrame::IsLast() const
+    {
+        return _header ? _header->is_last : false;
+    }
+
+    void AudioFrame::SetStream(uint32_t target, int32_t session_id, int64_t sequence_number, bool is_last)
+    {
+        if (_header) {
+            _header->target = target;
+            _header->session_id = session_id;
+            _header->sequence_number = sequence_number;
+            _header->is_last = is_last;
+        }
+    }
+
+    bool AudioFrame::HasPosition() const
+    {
+        return _header ? _header->has_position : false;
+    }
+
+    std::array<float, 3> AudioFrame::GetPosition() const
+    {
+        return _header ? _header->position : std::array<float, 3>{};
+    }
+
+    void AudioFrame::SetPosition(const std::array<float, 3>& position)
+    {
+        if (_header) {
+            _header->has_position = true;
+            _header->position = position;
+        }
+    }
+
+    //
+    // Samples
+    //
+
+    const int16_t* AudioFrame::GetInt16() const
+    {
+        if (!_header || _header->format != AudioSampleFormat::INT16) {
+            return nullptr;
+        }
+        return reinterpret_cast<const int16_t*>(data());
+    }
+
+    const float* AudioFrame::GetFloat() const
+    {
+        if (!_header || _header->format != AudioSampleFormat::FLOAT32) {
+            return nullptr;
+        }
+        return reinterpret_cast<const float*>(data());
+    }
+
+    int16_t* AudioFrame::GetInt16()
+    {
+        if (!_header || _header->format != AudioSampleFormat::INT16) {
+            return nullptr;
+        }
+        return reinterpret_cast<int16_t*>(data());
+    }
+
+    float* AudioFrame::GetFloat()
+    {
+        if (!_header || _header->format != AudioSampleFormat::FLOAT32) {
+            return nullptr;
+        }
+        return reinterpret_cast<float*>(data());
+    }
+}
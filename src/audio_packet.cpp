@@ -1,8 +1,15 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 // Copyright (c) 2015-2022 mumlib2 contributors
 
+//stdlib
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//mumlib
 #include "mumlib2/exceptions.h"
 #include "mumlib2_private/audio_packet.h"
+#include "mumlib2_private/tracer.h"
 #include "mumlib2_private/varint.h"
 
 namespace mumlib2 {
@@ -10,28 +17,64 @@ namespace mumlib2 {
     //
     // Ctor
     //
-    AudioPacket AudioPacket::Decode(const uint8_t* buffer, size_t length,size_t pos)
+    AudioPacketError AudioPacket::Parse(const uint8_t* buffer, size_t length, size_t pos, AudioPacket& packet)
     {
-        AudioPacket packet;
-        packet.parse_header(buffer, length, pos);
+        MUMLIB2_TRACE_SCOPE("AudioPacket::Parse", PACKET);
+
+        packet.clear();
+
+        if (!buffer || pos >= length) {
+            return AudioPacketError::TRUNCATED;
+        }
+
+        packet.parse_header(buffer, pos);
 
         switch (packet.GetHeaderType()) {
             case AudioPacketType::CeltAplha:
             case AudioPacketType::Speex:
             case AudioPacketType::CeltBeta:
             case AudioPacketType::Opus:
-                packet.parse_audio(buffer, length, pos+1);
-                break;
+                return packet.parse_audio(buffer, length, pos + 1);
             case AudioPacketType::Ping:
-                packet.parse_ping(buffer, length, pos + 1);
-                break;
+                return packet.parse_ping(buffer, length, pos + 1);
             default:
-                break;
+                return AudioPacketError::UNKNOWN_TYPE;
         }
+    }
+
+    AudioPacket AudioPacket::Decode(const uint8_t* buffer, size_t length, size_t pos)
+    {
+        AudioPacket packet;
+
+        auto error = Parse(buffer, length, pos, packet);
+        if (error != AudioPacketError::NONE) {
+            throw AudioPacketException(std::string("malformed packet: ") + GetErrorString(error));
+        }
+
         return packet;
     }
 
-    AudioPacket AudioPacket::CreateAudioOpusPacket(uint8_t target, int64_t sequence_number, const uint8_t* payload, size_t payload_len, bool is_last)
+    const char* AudioPacket::GetErrorString(AudioPacketError error)
+    {
+        switch (error) {
+            case AudioPacketError::NONE:
+                return "no error";
+            case AudioPacketError::TRUNCATED:
+                return "truncated";
+            case AudioPacketError::PAYLOAD_LENGTH:
+                return "payload length exceeds packet";
+            case AudioPacketError::POSITION_LENGTH:
+                return "invalid position data length";
+            case AudioPacketError::TRAILING_DATA:
+                return "trailing data";
+            case AudioPacketError::UNKNOWN_TYPE:
+                return "unknown type";
+        }
+        return "unknown error";
+    }
+
+    AudioPacket AudioPacket::CreateAudioOpusPacket(uint8_t target, int64_t sequence_number, const uint8_t* payload, size_t payload_len, bool is_last,
+        const std::optional<std::array<float, 3>>& position)
     {
         AudioPacket packet;
         packet._header_target = target;
@@ -40,6 +83,11 @@ namespace mumlib2 {
         packet._audio_last = is_last;
         packet._audio_sequencenum = sequence_number;
         packet._audio_payload = std::vector<uint8_t>(payload, payload + payload_len);
+
+        if (position.has_value()) {
+            packet._audio_has_position = true;
+            packet._audio_position = *position;
+        }
         return packet;
     }
 
@@ -80,7 +128,12 @@ namespace mumlib2 {
             //opus payload
             result.insert(result.end(), _audio_payload.begin(), _audio_payload.end());
 
-            //TODO: position data
+            //position data, raw floats as written by the Mumble client
+            if (_audio_has_position) {
+                auto offset = result.size();
+                result.resize(offset + sizeof(_audio_position));
+                std::memcpy(&result[offset], _audio_position.data(), sizeof(_audio_position));
+            }
         }
         else {
             throw AudioPacketException("unsupported type");
@@ -122,6 +175,11 @@ namespace mumlib2 {
         return _audio_last;
     }
 
+    bool AudioPacket::GetAudioHasPosition() const
+    {
+        return _audio_has_position;
+    }
+
     const std::array<float, 3>& AudioPacket::GetAudioPosition() const
     {
         return _audio_position;
@@ -132,66 +190,125 @@ namespace mumlib2 {
         return _ping_timestamp;
     }
 
+    //
+    // Receive
+    //
+
+    void AudioPacket::SetReceiveTime(std::chrono::system_clock::time_point time, bool kernel)
+    {
+        _receive_time = time;
+        _receive_kernel = kernel;
+    }
+
+    std::chrono::system_clock::time_point AudioPacket::GetReceiveTime() const
+    {
+        return _receive_time;
+    }
+
+    bool AudioPacket::GetReceiveTimeKernel() const
+    {
+        return _receive_kernel;
+    }
+
     //
     // Parser
     //
 
-    void AudioPacket::parse_header(const uint8_t* buffer, size_t length, size_t pos)
+    void AudioPacket::clear()
+    {
+        _header_type = AudioPacketType::Opus;
+        _header_target = 0;
+
+        _audio_sessionid = 0;
+        _audio_sequencenum = 0;
+        _audio_last = false;
+        _audio_payload.clear();
+        _audio_has_position = false;
+        _audio_position = {};
+
+        _ping_timestamp = 0;
+
+        _receive_time = {};
+        _receive_kernel = false;
+    }
+
+    void AudioPacket::parse_header(const uint8_t* buffer, size_t pos)
     {
         _header_type = static_cast<AudioPacketType>(buffer[pos] & _header_type_mask);
         _header_target = buffer[pos] & _header_target_mask;
     }
 
-    void AudioPacket::parse_audio(const uint8_t* buffer, size_t length, size_t pos)
+    AudioPacketError AudioPacket::parse_audio(const uint8_t* buffer, size_t length, size_t pos)
     {
         //session ID
-        VarInt varint_sessionid(&buffer[pos]);
-        _audio_sessionid = varint_sessionid.Value();
-        pos += varint_sessionid.Size();
+        size_t size = VarInt::Decode(buffer + pos, length - pos, _audio_sessionid);
+        if (!size) {
+            return AudioPacketError::TRUNCATED;
+        }
+        pos += size;
 
         //sequence number
-        VarInt varint_sequencenumber(&buffer[pos]);
-        _audio_sequencenum = varint_sequencenumber.Value();
-        pos += varint_sequencenumber.Size();
+        size = VarInt::Decode(buffer + pos, length - pos, _audio_sequencenum);
+        if (!size) {
+            return AudioPacketError::TRUNCATED;
+        }
+        pos += size;
 
         //opus
         if (GetHeaderType() == AudioPacketType::Opus) {
             //parse header
-            VarInt varint_sequencenumber(&buffer[pos]);
-            int64_t header = varint_sequencenumber.Value();
-            pos += varint_sequencenumber.Size();
+            int64_t header = 0;
+            size = VarInt::Decode(buffer + pos, length - pos, header);
+            if (!size) {
+                return AudioPacketError::TRUNCATED;
+            }
+            pos += size;
 
             //parse last message bit
             _audio_last = (header & _audio_opus_last_mask) == _audio_opus_last_mask;
 
             //copy buffer
-            auto opus_length = header & _audio_opus_length_mask;
-            _audio_payload = std::vector<uint8_t>(buffer + pos, buffer + pos + opus_length);
+            auto opus_length = static_cast<size_t>(header & _audio_opus_length_mask);
+            if (opus_length > length - pos) {
+                return AudioPacketError::PAYLOAD_LENGTH;
+            }
+            _audio_payload.assign(buffer + pos, buffer + pos + opus_length);
 
             //increment pos
             pos += opus_length;
         }
         else {
             //TODO: support other voice types other than opus
-            return;
+            return AudioPacketError::NONE;
         }
 
-        //parse position data
+        //parse position data, either absent or exactly three floats
         if (pos < length) {
-            for (size_t i = 0; i < _audio_position.size(); i++) {
-                _audio_position[i] = reinterpret_cast<const float*>(buffer + pos)[i];
+            if (length - pos != sizeof(_audio_position)) {
+                return AudioPacketError::POSITION_LENGTH;
             }
+
+            std::memcpy(_audio_position.data(), buffer + pos, sizeof(_audio_position));
+            _audio_has_position = std::all_of(_audio_position.begin(), _audio_position.end(), [](float value) {
+                return std::isfinite(value);
+            });
+            pos += sizeof(_audio_position);
         }
 
         //check that we are not overrun buffer
         if (pos != length) {
-            throw AudioPacketException("buffer mismath");
+            return AudioPacketError::TRAILING_DATA;
         }
+
+        return AudioPacketError::NONE;
     }
 
-    void AudioPacket::parse_ping(const uint8_t* buffer, size_t length, size_t pos) {
+    AudioPacketError AudioPacket::parse_ping(const uint8_t* buffer, size_t length, size_t pos) {
         //timestamp
-        VarInt varint_sessionid(&buffer[pos]);
-        _ping_timestamp = varint_sessionid.Value();
+        if (!VarInt::Decode(buffer + pos, length - pos, _ping_timestamp)) {
+            return AudioPacketError::TRUNCATED;
+        }
+
+        return AudioPacketError::NONE;
     }
 }
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//stdlib
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+//mumlib
+#include "mumlib2_private/audio_panner.h"
+
+namespace mumlib2 {
+
+    void AudioPanner::SetListener(const std::array<float, 3>& position, const std::array<float, 3>& forward)
+    {
+        //right = up x forward with up = +y, heading is projected onto the horizontal plane
+        float right_x = forward[2];
+        float right_z = -forward[0];
+        float length = std::sqrt(right_x * right_x + right_z * right_z);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _position = position;
+        if (length > 0.0f) {
+            _right = { right_x / length, 0.0f, right_z / length };
+        }
+    }
+
+    std::pair<float, float> AudioPanner::GetGains(const std::array<float, 3>& source)
+    {
+        std::array<float, 3> position;
+        std::array<float, 3> right;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            position = _position;
+            right = _right;
+        }
+
+        float dx = source[0] - position[0];
+        float dy = source[1] - position[1];
+        float dz = source[2] - position[2];
+        float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+        //on top of the listener, no direction to pan to
+        if (distance < 1e-3f) {
+            return { std::numbers::sqrt2_v<float> / 2, std::numbers::sqrt2_v<float> / 2 };
+        }
+
+        float pan = std::clamp((dx * right[0] + dy * right[1] + dz * right[2]) / distance, -1.0f, 1.0f);
+        float angle = (pan + 1.0f) * std::numbers::pi_v<float> / 4;
+
+        float attenuation = std::clamp(_distance_min / distance, _gain_min, 1.0f);
+
+        return { std::cos(angle) * attenuation, std::sin(angle) * attenuation };
+    }
+}
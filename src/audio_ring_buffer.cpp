@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//stdlib
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+//mumlib
+#include "mumlib2_private/audio_ring_buffer.h"
+
+namespace mumlib2 {
+
+    //
+    // Ctor
+    //
+
+    AudioRingBuffer::AudioRingBuffer(size_t capacity)
+    {
+        capacity = std::bit_ceil(std::max<size_t>(capacity, 2));
+        _buffer = std::make_unique<int16_t[]>(capacity);
+        _mask = capacity - 1;
+    }
+
+    //
+    // Public
+    //
+
+    size_t AudioRingBuffer::Write(const int16_t* data, size_t length)
+    {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        const size_t tail = _tail.load(std::memory_order_acquire);
+
+        length = std::min(length, Capacity() - (head - tail));
+
+        //copy in up to two parts because of wrap around
+        const size_t offset = head & _mask;
+        const size_t first = std::min(length, Capacity() - offset);
+        std::memcpy(&_buffer[offset], data, first * sizeof(int16_t));
+        std::memcpy(&_buffer[0], data + first, (length - first) * sizeof(int16_t));
+
+        _head.store(head + length, std::memory_order_release);
+        return length;
+    }
+
+    size_t AudioRingBuffer::Read(int16_t* data, size_t length)
+    {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        const size_t head = _head.load(std::memory_order_acquire);
+
+        length = std::min(length, head - tail);
+
+        const size_t offset = tail & _mask;
+        const size_t first = std::min(length, Capacity() - offset);
+        std::memcpy(data, &_buffer[offset], first * sizeof(int16_t));
+        std::memcpy(data + first, &_buffer[0], (length - first) * sizeof(int16_t));
+
+        _tail.store(tail + length, std::memory_order_release);
+        return length;
+    }
+
+    void AudioRingBuffer::Clear()
+    {
+        _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    size_t AudioRingBuffer::Available() const
+    {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    size_t AudioRingBuffer::Capacity() const
+    {
+        return _mask + 1;
+    }
+}
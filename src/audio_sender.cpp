@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//mumlib
+#include "mumlib2/exceptions.h"
+#include "mumlib2_private/audio_sender.h"
+#include "mumlib2_private/thread_scheduler.h"
+
+namespace mumlib2 {
+
+    //
+    // Ctor/Dtor
+    //
+
+    AudioSender::AudioSender(AudioEncoder& encoder, std::function<void(std::vector<uint8_t>&&)> send_function)
+        : _encoder(encoder), _send_function(std::move(send_function))
+    {
+    }
+
+    AudioSender::~AudioSender()
+    {
+        Stop();
+    }
+
+    //
+    // Public
+    //
+
+    void AudioSender::Start(const ThreadOptions& options)
+    {
+        if (_running.exchange(true)) {
+            return;
+        }
+
+        _thread = std::thread(&AudioSender::run, this, options);
+    }
+
+    void AudioSender::Stop()
+    {
+        _running = false;
+        if (_thread.joinable()) {
+            _thread.join();
+        }
+    }
+
+    bool AudioSender::IsRunning() const
+    {
+        return _running;
+    }
+
+    void AudioSender::SetTarget(uint32_t target)
+    {
+        _target = target;
+    }
+
+    uint64_t AudioSender::GetDeadlineMisses() const
+    {
+        return _deadline_misses;
+    }
+
+    //
+    // Private
+    //
+
+    void AudioSender::run(ThreadOptions options)
+    {
+        using clock = std::chrono::steady_clock;
+
+        ThreadScheduler::Apply(options, _logger);
+
+        auto deadline = clock::now();
+        bool talking = false;
+
+        while (_running) {
+            std::vector<uint8_t> packet;
+            try {
+                packet = _encoder.EncodeNext(_target);
+            }
+            catch (const AudioEncoderException& ex) {
+                _logger.error("AudioSender::run() -> encode failed: %s", ex.what());
+            }
+
+            if (packet.empty()) {
+                //producer stopped, restart the schedule when audio comes back
+                if (talking && clock::now() > deadline + _encoder.GetPacketDuration() * _catchup_limit) {
+                    talking = false;
+                }
+
+                std::this_thread::sleep_for(_idle_interval);
+                continue;
+            }
+
+            if (!talking) {
+                talking = true;
+                deadline = clock::now();
+            }
+
+            _send_function(std::move(packet));
+
+            //advance on the absolute schedule, give up catching up after a long stall
+            deadline += _encoder.GetPacketDuration();
+            auto now = clock::now();
+            if (now > deadline + _encoder.GetPacketDuration() * _catchup_limit) {
+                _logger.warn("AudioSender::run() -> fell behind schedule, resynchronizing");
+                deadline = now;
+            }
+
+            std::this_thread::sleep_until(deadline);
+            if (clock::now() > deadline + _deadline_tolerance) {
+                _deadline_misses++;
+            }
+        }
+    }
+}
@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//mumlib
+#include "mumlib2_private/audio_subscription.h"
+
+namespace mumlib2 {
+
+    //
+    // Modification
+    //
+
+    void AudioSubscription::Session(int32_t session_id, bool subscribe)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (subscribe) {
+            _sessions.insert(session_id);
+        }
+        else {
+            _sessions.erase(session_id);
+        }
+    }
+
+    void AudioSubscription::Channel(int32_t channel_id, bool subscribe)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (subscribe) {
+            _channels.insert(channel_id);
+        }
+        else {
+            _channels.erase(channel_id);
+        }
+    }
+
+    void AudioSubscription::Predicate(std::function<bool(const MumbleUser&)> predicate)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _predicate = std::move(predicate);
+    }
+
+    void AudioSubscription::Reset()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _sessions.clear();
+        _channels.clear();
+        _predicate = nullptr;
+    }
+
+    //
+    // Check
+    //
+
+    bool AudioSubscription::Check(int32_t session_id, const std::function<std::optional<MumbleUser>(int32_t)>& user_get)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        //no subscription at all
+        if (_sessions.empty() && _channels.empty() && !_predicate) {
+            return true;
+        }
+
+        if (_sessions.contains(session_id)) {
+            return true;
+        }
+
+        if (_channels.empty() && !_predicate) {
+            return false;
+        }
+
+        auto user = user_get(session_id);
+        if (!user.has_value()) {
+            return false;
+        }
+
+        if (_channels.contains(user->channelId)) {
+            return true;
+        }
+
+        return _predicate && _predicate(*user);
+    }
+}
@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//stdlib
+#include <algorithm>
+
+//mumlib
+#include "mumlib2/constants.h"
+#include "mumlib2_private/bitrate_controller.h"
+
+namespace mumlib2 {
+
+    //
+    // Ctor
+    //
+
+    BitrateController::BitrateController(uint32_t bitrate, uint32_t frame_duration_ms, uint32_t frames_per_packet)
+    {
+        prefer(bitrate, frame_duration_ms, frames_per_packet);
+    }
+
+    //
+    // Configuration
+    //
+
+    void BitrateController::SetPreferred(uint32_t bitrate, uint32_t frame_duration_ms, uint32_t frames_per_packet)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        prefer(bitrate, frame_duration_ms, frames_per_packet);
+    }
+
+    void BitrateController::SetServerMaxBandwidth(uint32_t max_bandwidth)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _server_max_bandwidth = max_bandwidth;
+        fit();
+    }
+
+    void BitrateController::SetTunnel(bool tunnel)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_tunnel == tunnel) {
+            return;
+        }
+
+        _tunnel = tunnel;
+        fit();
+    }
+
+    void BitrateController::SetPositional(bool positional)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_positional == positional) {
+            return;
+        }
+
+        _positional = positional;
+        fit();
+    }
+
+    void BitrateController::Reset()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _server_max_bandwidth = 0;
+        _tunnel = false;
+        _last_good = _last_late = _last_lost = 0;
+        _rtt_min = std::chrono::milliseconds::max();
+
+        prefer(_bitrate_preferred, _frame_duration, _frames_per_packet_preferred);
+    }
+
+    void BitrateController::prefer(uint32_t bitrate, uint32_t frame_duration_ms, uint32_t frames_per_packet)
+    {
+        _bitrate_preferred = std::max(bitrate, _bitrate_min);
+        _frame_duration = frame_duration_ms;
+        _frames_per_packet_preferred = frames_per_packet;
+
+        _congestion_budget = _bitrate_preferred + GetOverhead(_frame_duration * _frames_per_packet_preferred, _tunnel, _positional);
+        fit();
+    }
+
+    //
+    // Measurement
+    //
+
+    void BitrateController::Update(uint32_t good, uint32_t late, uint32_t lost, std::chrono::milliseconds rtt)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        //counters restart with every crypt setup
+        if (good < _last_good || late < _last_late || lost < _last_lost) {
+            _last_good = _last_late = _last_lost = 0;
+        }
+
+        uint32_t delta_good = good - _last_good;
+        uint32_t delta_bad = (late - _last_late) + (lost - _last_lost);
+        uint32_t delta_total = delta_good + delta_bad;
+
+        bool congested = false;
+        bool clear = true;
+
+        if (delta_total >= _loss_packets_min) {
+            uint32_t loss = delta_bad * 1000 / delta_total;
+            congested = loss > _loss_congested;
+            clear = loss < _loss_clear;
+
+            _last_good = good;
+            _last_late = late;
+            _last_lost = lost;
+        }
+
+        if (rtt.count() > 0) {
+            _rtt_min = std::min(_rtt_min, rtt);
+            if (rtt > _rtt_min + _rtt_queueing) {
+                congested = true;
+            }
+        }
+
+        uint32_t budget_max = _bitrate_preferred + GetOverhead(_frame_duration * _frames_per_packet_preferred, _tunnel, _positional);
+        uint32_t budget_min = _bitrate_min + GetOverhead(MUMBLE_OPUS_MAXLENGTH, _tunnel, _positional);
+
+        if (congested) {
+            _congestion_budget = std::max(budget_min, _congestion_budget * _budget_backoff_num / _budget_backoff_den);
+        }
+        else if (clear) {
+            _congestion_budget = std::min(budget_max, _congestion_budget + _budget_step);
+        }
+
+        fit();
+    }
+
+    //
+    // Result
+    //
+
+    uint32_t BitrateController::GetBitrate() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _bitrate;
+    }
+
+    uint32_t BitrateController::GetFramesPerPacket() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _frames_per_packet;
+    }
+
+    uint32_t BitrateController::GetOverhead(uint32_t packet_duration_ms, bool tunnel, bool positional)
+    {
+        if (!packet_duration_ms) {
+            return 0;
+        }
+
+        uint32_t packet_overhead = (tunnel ? _overhead_tunnel : _overhead_udp) + (positional ? _overhead_position : 0);
+        return packet_overhead * 8 * 1000 / packet_duration_ms;
+    }
+
+    void BitrateController::fit()
+    {
+        uint32_t budget = _congestion_budget;
+        if (_server_max_bandwidth) {
+            budget = std::min(budget, _server_max_bandwidth);
+        }
+
+        //grow packets while headers eat too much of the budget
+        uint32_t frames_per_packet = _frames_per_packet_preferred;
+        while (true) {
+            uint32_t overhead = GetOverhead(_frame_duration * frames_per_packet, _tunnel, _positional);
+            uint32_t payload = budget > overhead ? budget - overhead : 0;
+
+            bool can_grow = _frame_duration * (frames_per_packet + 1) <= MUMBLE_OPUS_MAXLENGTH;
+            if (payload >= std::min(_bitrate_low, _bitrate_preferred) || !can_grow) {
+                _bitrate = std::clamp(payload, _bitrate_min, _bitrate_preferred);
+                break;
+            }
+
+            frames_per_packet++;
+        }
+
+        _frames_per_packet = frames_per_packet;
+    }
+}
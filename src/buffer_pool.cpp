@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//mumlib
+#include "mumlib2_private/buffer_pool.h"
+
+namespace mumlib2 {
+
+    //
+    // Buffer
+    //
+
+    BufferPool::Buffer::Buffer(BufferPool* pool, std::unique_ptr<uint8_t[]> data, size_t slab)
+        : _pool(pool), _data(std::move(data)), _slab(slab)
+    {
+    }
+
+    BufferPool::Buffer::Buffer(Buffer&& other) noexcept
+        : _pool(other._pool), _data(std::move(other._data)), _slab(other._slab)
+    {
+        other._pool = nullptr;
+    }
+
+    BufferPool::Buffer& BufferPool::Buffer::operator=(Buffer&& other) noexcept
+    {
+        if (this != &other) {
+            Release();
+            _pool = other._pool;
+            _data = std::move(other._data);
+            _slab = other._slab;
+            other._pool = nullptr;
+        }
+        return *this;
+    }
+
+    BufferPool::Buffer::~Buffer()
+    {
+        Release();
+    }
+
+    uint8_t* BufferPool::Buffer::Data() const
+    {
+        return _data.get();
+    }
+
+    size_t BufferPool::Buffer::Size() const
+    {
+        return _data ? _slab_sizes[_slab] : 0;
+    }
+
+    void BufferPool::Buffer::Release()
+    {
+        if (_pool && _data) {
+            _pool->release(std::move(_data), _slab);
+        }
+        _pool = nullptr;
+        _data.reset();
+    }
+
+    //
+    // Pool
+    //
+
+    BufferPool& BufferPool::Instance()
+    {
+        static BufferPool instance;
+        return instance;
+    }
+
+    BufferPool::Buffer BufferPool::Acquire(size_t length)
+    {
+        for (size_t slab = 0; slab < _slab_sizes.size(); slab++) {
+            if (length > _slab_sizes[slab]) {
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                auto& free_list = _free[slab];
+                if (!free_list.empty()) {
+                    auto data = std::move(free_list.back());
+                    free_list.pop_back();
+                    return Buffer(this, std::move(data), slab);
+                }
+            }
+
+            return Buffer(this, std::make_unique_for_overwrite<uint8_t[]>(_slab_sizes[slab]), slab);
+        }
+
+        return {};
+    }
+
+    void BufferPool::release(std::unique_ptr<uint8_t[]> data, size_t slab)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto& free_list = _free[slab];
+        if (free_list.size() < _slab_retain) {
+            free_list.push_back(std::move(data));
+        }
+    }
+}
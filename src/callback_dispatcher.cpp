@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//stdlib
+#include <algorithm>
+#include <thread>
+
+//mumlib
+#include "mumlib2_private/callback_dispatcher.h"
+#include "mumlib2_private/tracer.h"
+
+namespace mumlib2 {
+
+    //
+    // Ctor/Dtor
+    //
+
+    CallbackDispatcher::CallbackDispatcher(Callback& callback, DispatchOptions options)
+        : _callback(callback), _options(std::move(options)), _events(_options.capacity), _audio(_options.capacity)
+    {
+    }
+
+    CallbackDispatcher::~CallbackDispatcher()
+    {
+        SetBlocking(false);
+    }
+
+    bool CallbackDispatcher::Validate(const DispatchOptions& options)
+    {
+        if (!options.capacity) {
+            return false;
+        }
+
+        //eviction and coalescing would reorder or lose control events of other classes
+        if (options.audio == DispatchPolicy::COALESCE) {
+            return false;
+        }
+        if (options.state == DispatchPolicy::DROP_OLDEST) {
+            return false;
+        }
+        if (options.control == DispatchPolicy::DROP_OLDEST || options.control == DispatchPolicy::COALESCE) {
+            return false;
+        }
+
+        return true;
+    }
+
+    //
+    // Producer
+    //
+
+    void CallbackDispatcher::Push(DispatchClass type, uint64_t key, const char* name, Function function)
+    {
+        Event event{ std::move(function), name, key, false };
+
+        switch (type) {
+        case DispatchClass::AUDIO:
+            push(_audio, event, _options.audio);
+            break;
+        case DispatchClass::STATE:
+            if (_options.state == DispatchPolicy::COALESCE) {
+                {
+                    std::lock_guard<std::mutex> lock(_coalesce_mutex);
+                    auto [it, inserted] = _coalesce.try_emplace(key);
+                    it->second = std::move(event.function);
+                    if (!inserted) {
+                        //marker is still queued, it delivers the replacement
+                        _coalesced++;
+                        return;
+                    }
+                }
+
+                event.coalesced = true;
+                if (!push(_events, event, DispatchPolicy::BLOCK)) {
+                    //without a queued marker the key would swallow every later event
+                    std::lock_guard<std::mutex> lock(_coalesce_mutex);
+                    _coalesce.erase(key);
+                }
+            }
+            else {
+                push(_events, event, _options.state);
+            }
+            break;
+        case DispatchClass::CONTROL:
+            push(_events, event, _options.control);
+            break;
+        }
+    }
+
+    bool CallbackDispatcher::push(BoundedQueue<Event>& queue, Event& event, DispatchPolicy policy)
+    {
+        while (!queue.TryPush(event)) {
+            if (policy == DispatchPolicy::DROP_NEWEST || !_blocking) {
+                _dropped++;
+                return false;
+            }
+
+            if (policy == DispatchPolicy::DROP_OLDEST) {
+                Event oldest;
+                if (queue.TryPop(oldest)) {
+                    _depth--;
+                    _dropped++;
+                }
+                continue;
+            }
+
+            //blocking the io thread is the backpressure, it resumes as soon as the consumer catches up
+            std::this_thread::sleep_for(_block_interval);
+        }
+
+        int64_t depth = ++_depth;
+        int64_t depth_max = _depth_max.load(std::memory_order_relaxed);
+        while (depth > depth_max && !_depth_max.compare_exchange_weak(depth_max, depth, std::memory_order_relaxed)) {
+        }
+
+        if (depth == 1 && _options.notify) {
+            _options.notify();
+        }
+
+        if (_waiting) {
+            std::lock_guard<std::mutex> lock(_wait_mutex);
+            _wait_condition.notify_all();
+        }
+
+        return true;
+    }
+
+    void CallbackDispatcher::SetBlocking(bool blocking)
+    {
+        _blocking = blocking;
+    }
+
+    //
+    // Consumer
+    //
+
+    size_t CallbackDispatcher::Pump(std::chrono::milliseconds wait, size_t max_events)
+    {
+        if (wait.count() > 0 && _depth <= 0) {
+            _waiting = true;
+            {
+                std::unique_lock<std::mutex> lock(_wait_mutex);
+                _wait_condition.wait_for(lock, wait, [this]() { return _depth > 0; });
+            }
+            _waiting = false;
+        }
+
+        size_t delivered = 0;
+        Event event;
+        while (delivered < max_events && (_events.TryPop(event) || _audio.TryPop(event))) {
+            _depth--;
+            deliver(event);
+            delivered++;
+        }
+
+        return delivered;
+    }
+
+    void CallbackDispatcher::deliver(Event& event)
+    {
+        if (event.coalesced) {
+            std::unique_lock<std::mutex> lock(_coalesce_mutex);
+            auto it = _coalesce.find(event.key);
+            if (it == _coalesce.end()) {
+                return;
+            }
+
+            event.function = std::move(it->second);
+            _coalesce.erase(it);
+        }
+
+        Function function = std::move(event.function);
+        if (function) {
+            MUMLIB2_TRACE_SCOPE(event.name, USER_CALLBACK);
+            function(_callback);
+        }
+    }
+
+    //
+    // Statistics
+    //
+
+    void CallbackDispatcher::GetStatistics(Statistics& statistics) const
+    {
+        statistics.dispatch_queue_depth = static_cast<uint64_t>(std::max<int64_t>(_depth, 0));
+        statistics.dispatch_queue_depth_max = static_cast<uint64_t>(_depth_max.load());
+        statistics.dispatch_events_dropped = _dropped;
+        statistics.dispatch_events_coalesced = _coalesced;
+    }
+}
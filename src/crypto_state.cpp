@@ -11,6 +11,7 @@
 
 //mumlib
 #include "mumlib2_private/crypto_state.h"
+#include "mumlib2_private/tracer.h"
 
 
 using namespace std;
@@ -32,6 +33,10 @@ namespace mumlib2 {
 
 
 	CryptState::CryptState() {
+		reset();
+	}
+
+	void CryptState::reset() {
 		for (int i = 0; i < 0x100; i++)
 			decrypt_history[i] = 0;
 		bInit = false;
@@ -63,12 +68,48 @@ namespace mumlib2 {
 
 	void CryptState::setDecryptIV(const unsigned char* iv) {
 		memcpy(decrypt_iv, iv, AES_BLOCK_SIZE);
+		uiResync++;
 	}
 
 	const unsigned char* CryptState::getEncryptIV() const {
 		return encrypt_iv;
 	}
 
+	unsigned int CryptState::getGood() const {
+		return uiGood;
+	}
+
+	unsigned int CryptState::getLate() const {
+		return uiLate;
+	}
+
+	unsigned int CryptState::getLost() const {
+		return uiLost;
+	}
+
+	unsigned int CryptState::getResync() const {
+		return uiResync;
+	}
+
+	void CryptState::setRemoteStats(unsigned int good, unsigned int late, unsigned int lost, unsigned int resync) {
+		uiRemoteGood = good;
+		uiRemoteLate = late;
+		uiRemoteLost = lost;
+		uiRemoteResync = resync;
+	}
+
+	unsigned int CryptState::getRemoteGood() const {
+		return uiRemoteGood;
+	}
+
+	unsigned int CryptState::getRemoteLate() const {
+		return uiRemoteLate;
+	}
+
+	unsigned int CryptState::getRemoteLost() const {
+		return uiRemoteLost;
+	}
+
 	void CryptState::encrypt(const unsigned char* source, unsigned char* dst, unsigned int plain_length) {
 		unsigned char tag[AES_BLOCK_SIZE];
 
@@ -86,6 +127,8 @@ namespace mumlib2 {
 	}
 
 	bool CryptState::decrypt(const unsigned char* source, unsigned char* dst, unsigned int crypted_length) {
+		MUMLIB2_TRACE_SCOPE("CryptState::decrypt", CRYPT);
+
 		if (crypted_length < 4)
 			return false;
 
@@ -26,7 +26,91 @@ namespace mumlib2 {
     //
     // Audio
     //
-    
+    bool Mumlib2::AudioSetBitrate(uint32_t bitrate)
+    {
+        return impl->AudioSetBitrate(bitrate);
+    }
+
+    bool Mumlib2::AudioSetEncoderProfile(const AudioEncoderProfile& profile)
+    {
+        return impl->AudioSetEncoderProfile(profile);
+    }
+
+    void Mumlib2::AudioSetFrameAllocator(std::shared_ptr<AudioFrameAllocator> allocator)
+    {
+        impl->AudioSetFrameAllocator(std::move(allocator));
+    }
+
+    bool Mumlib2::AudioSetFrameDuration(uint32_t frame_duration_ms, uint32_t frames_per_packet)
+    {
+        return impl->AudioSetFrameDuration(frame_duration_ms, frames_per_packet);
+    }
+
+    void Mumlib2::AudioSetPassthrough(bool enabled)
+    {
+        impl->AudioSetPassthrough(enabled);
+    }
+
+    bool Mumlib2::AudioSetPanning(bool enabled)
+    {
+        return impl->AudioSetPanning(enabled);
+    }
+
+    void Mumlib2::AudioSetListener(float x, float y, float z, float forward_x, float forward_y, float forward_z)
+    {
+        impl->AudioSetListener({ x, y, z }, { forward_x, forward_y, forward_z });
+    }
+
+    void Mumlib2::AudioSetPosition(float x, float y, float z)
+    {
+        impl->AudioSetPosition(std::array<float, 3>{ x, y, z });
+    }
+
+    void Mumlib2::AudioClearPosition()
+    {
+        impl->AudioSetPosition(std::nullopt);
+    }
+
+    bool Mumlib2::AudioSetOutputFormat(AudioSampleFormat format, uint32_t channels)
+    {
+        return impl->AudioSetOutputFormat(format, channels);
+    }
+
+    bool Mumlib2::AudioSetInputSamplerate(uint32_t samplerate, ResamplerQuality quality)
+    {
+        return impl->AudioSetInputSamplerate(samplerate, quality);
+    }
+
+    bool Mumlib2::AudioSetOutputSamplerate(uint32_t samplerate, ResamplerQuality quality)
+    {
+        return impl->AudioSetOutputSamplerate(samplerate, quality);
+    }
+
+    bool Mumlib2::AudioSetSendThread(bool enabled, const ThreadOptions& options)
+    {
+        return impl->AudioSetSendThread(enabled, options);
+    }
+
+    void Mumlib2::AudioSubscribeSession(int32_t session_id, bool subscribe)
+    {
+        impl->AudioSubscribeSession(session_id, subscribe);
+    }
+
+    void Mumlib2::AudioSubscribeChannel(int32_t channel_id, bool subscribe)
+    {
+        impl->AudioSubscribeChannel(channel_id, subscribe);
+    }
+
+    void Mumlib2::AudioSubscribePredicate(std::function<bool(const MumbleUser&)> predicate)
+    {
+        impl->AudioSubscribePredicate(std::move(predicate));
+    }
+
+    void Mumlib2::AudioSubscribeReset()
+    {
+        impl->AudioSubscribeReset();
+    }
+
     //
     // Channel
     //
@@ -60,6 +144,58 @@ namespace mumlib2 {
         return ChannelJoin(id);
     }
 
+    //
+    // Dispatch
+    //
+    bool Mumlib2::DispatchSetOptions(const DispatchOptions& options)
+    {
+        return impl->DispatchSetOptions(options);
+    }
+
+    size_t Mumlib2::DispatchPump(std::chrono::milliseconds wait, size_t max_events)
+    {
+        return impl->DispatchPump(wait, max_events);
+    }
+
+    //
+    // Statistics
+    //
+    Statistics Mumlib2::StatisticsGet()
+    {
+        return impl->StatisticsGet();
+    }
+
+    std::vector<SpeakerStatistics> Mumlib2::StatisticsGetSpeakers()
+    {
+        return impl->StatisticsGetSpeakers();
+    }
+
+    //
+    // Trace
+    //
+    bool Mumlib2::TraceStart(size_t capacity, std::chrono::microseconds slow_callback)
+    {
+#if defined(MUMLIB2_TRACING)
+        return Tracer::Instance().Start(capacity, slow_callback);
+#else
+        return false;
+#endif
+    }
+
+    void Mumlib2::TraceStop()
+    {
+        Tracer::Instance().Stop();
+    }
+
+    bool Mumlib2::TraceExport(const std::string& path)
+    {
+#if defined(MUMLIB2_TRACING)
+        return Tracer::Instance().Export(path);
+#else
+        return false;
+#endif
+    }
+
     //
     // User
     //
@@ -125,6 +261,26 @@ namespace mumlib2 {
         impl->TransportRun();
     }
 
+    bool Mumlib2::runThread(const ThreadOptions& options) {
+        return impl->TransportRunThread(options);
+    }
+
+    std::error_code Mumlib2::TransportGetError() {
+        return impl->TransportGetError();
+    }
+
+    void Mumlib2::TransportSetReconnect(bool enabled, uint32_t delay_min_ms, uint32_t delay_max_ms) {
+        impl->TransportSetReconnect(enabled, delay_min_ms, delay_max_ms);
+    }
+
+    bool Mumlib2::TransportSetOptions(const TransportOptions& options) {
+        return impl->TransportSetOptions(options);
+    }
+
+    void Mumlib2::TransportSetTlsContext(std::shared_ptr<TlsContext> context) {
+        impl->TransportSetTlsContext(std::move(context));
+    }
+
     void Mumlib2::sendAudioData(const int16_t *pcmData, int pcmLength) {
         impl->AudioSend(pcmData, pcmLength);
     }
@@ -133,6 +289,14 @@ namespace mumlib2 {
         impl->AudioSendTarget(pcmData, pcmLength, targetId);
     }
 
+    void Mumlib2::sendAudioEnd(int targetId) {
+        impl->AudioSendEnd(targetId);
+    }
+
+    bool Mumlib2::sendEncodedOpus(int targetId, int64_t sequenceNumber, const uint8_t *payload, size_t payloadLength, bool is_last) {
+        return impl->AudioSendEncoded(targetId, sequenceNumber, payload, payloadLength, is_last);
+    }
+
     void Mumlib2::sendTextMessage(string message) {
         impl->TextSend(message);
     }
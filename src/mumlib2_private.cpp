@@ -10,8 +10,26 @@
 namespace mumlib2 {
 	Mumlib2Private::Mumlib2Private(Callback& callback) : _callback(callback)
 	{
-		audioDecoderCreate(MUMBLE_AUDIO_SAMPLERATE);
-        audioEncoderCreate(MUMBLE_AUDIO_SAMPLERATE, MUMBLE_OPUS_BITRATE);
+		audioDecoderCreate();
+        audioEncoderCreate(_audio_input_samplerate, _audio_bitrate, _audio_input_quality, _audio_encoder_profile);
+	}
+
+	Mumlib2Private::~Mumlib2Private()
+	{
+		//stop the send thread before the transport goes away
+		_audio_sender.reset();
+
+		//nobody pumps anymore, a full queue must not hold the io thread
+		if (_dispatcher) {
+			_dispatcher->SetBlocking(false);
+		}
+
+		transportThreadJoin();
+
+		//destroyed from one of its own callbacks, the io thread cannot wait for itself
+		if (_transport_thread.joinable()) {
+			_transport_thread.detach();
+		}
 	}
 
     //
@@ -21,6 +39,9 @@ namespace mumlib2 {
     {
         bool result = false;
 
+        //kept for the next connect and reconnects
+        _acl_tokens = tokens;
+
         //apply tokens to existing connection
         if (TransportGetState() == ConnectionState::CONNECTED) {
             result = transportSendAuthentication(tokens);
@@ -50,29 +71,344 @@ namespace mumlib2 {
             return;
         }
 
+        //the input ring takes a single producer, concurrent senders queue up here
+        std::lock_guard<std::mutex> lock(_audio_encoder_mutex);
+
         //check encoder availability
         if (!_audio_encoder) {
             return;
         }
 
-        //encode
-        auto packet = _audio_encoder->Encode(pcmData, pcmLength, target);
+        //accumulate
+        _audio_encoder->Push(pcmData, pcmLength);
+
+        //send thread encodes and paces on its own
+        if (_audio_sender) {
+            _audio_sender->SetTarget(target);
+            return;
+        }
+
+        //encode and send every complete packet
+        for (auto packet = _audio_encoder->EncodeNext(target); !packet.empty(); packet = _audio_encoder->EncodeNext(target)) {
+            transportSendAudio(std::move(packet));
+        }
+    }
+
+    void Mumlib2Private::AudioSendEnd(uint32_t target)
+    {
+        std::lock_guard<std::mutex> lock(_audio_encoder_mutex);
+        if (!_audio_encoder) {
+            return;
+        }
+
+        _audio_encoder->Flush();
 
-        //send
-        try {
-            transportSendAudio(packet.data(), packet.size());
+        //send thread closes the stream once it has caught up
+        if (_audio_sender) {
+            _audio_sender->SetTarget(target);
+            return;
+        }
+
+        for (auto packet = _audio_encoder->EncodeNext(target); !packet.empty(); packet = _audio_encoder->EncodeNext(target)) {
+            transportSendAudio(std::move(packet));
+        }
+    }
+
+    bool Mumlib2Private::AudioSendEncoded(uint32_t target, int64_t sequence_number, const uint8_t* payload, size_t payload_len, bool is_last)
+    {
+        if (!payload || !payload_len || sequence_number < 0) {
+            return false;
+        }
+
+        //already encoded, only framing is needed
+        auto packet = AudioPacket::CreateAudioOpusPacket(target, sequence_number, payload, payload_len, is_last).Encode();
+
+        //must fit whichever path is active when the io thread sends it
+        if (packet.size() > Transport::AUDIO_PACKET_MAX) {
+            return false;
         }
-        catch (const TransportException&) {}
+
+        return transportSendAudio(std::move(packet));
     }
 
-    void Mumlib2Private::audioDecoderCreate(uint32_t output_samplerate)
+    bool Mumlib2Private::AudioSetBitrate(uint32_t bitrate)
     {
-        _audio_decoder = std::make_unique<AudioDecoder>(MUMBLE_AUDIO_CHANNELS);
+        if (bitrate < MUMBLE_OPUS_BITRATE_MIN || bitrate > MUMBLE_OPUS_BITRATE_MAX) {
+            return false;
+        }
+
+        _audio_bitrate = bitrate;
+        _audio_bitrate_controller.SetPreferred(_audio_bitrate, _audio_frame_duration, _audio_frames_per_packet);
+        audioBitrateApply();
+        return true;
     }
 
-    void Mumlib2Private::audioEncoderCreate(uint32_t input_samplerate, uint32_t output_bitrate)
+    bool Mumlib2Private::AudioSetEncoderProfile(const AudioEncoderProfile& profile)
     {
-        _audio_encoder = std::make_unique<AudioEncoder>(output_bitrate);
+        if (profile.complexity > 10) {
+            return false;
+        }
+
+        //application mode can only be chosen at opus encoder creation
+        _audio_encoder_profile = profile;
+        audioEncoderCreate(_audio_input_samplerate, _audio_bitrate, _audio_input_quality, _audio_encoder_profile);
+        return true;
+    }
+
+    void Mumlib2Private::AudioSetFrameAllocator(std::shared_ptr<AudioFrameAllocator> allocator)
+    {
+        std::lock_guard<std::mutex> lock(_audio_frame_allocator_mutex);
+        _audio_frame_allocator = std::move(allocator);
+    }
+
+    bool Mumlib2Private::AudioSetFrameDuration(uint32_t frame_duration_ms, uint32_t frames_per_packet)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_audio_encoder_mutex);
+            if (!_audio_encoder->SetFrameDuration(frame_duration_ms, frames_per_packet)) {
+                return false;
+            }
+
+            //read by audioBitrateApply() on the io thread
+            _audio_frame_duration = frame_duration_ms;
+            _audio_frames_per_packet = frames_per_packet;
+        }
+        _audio_bitrate_controller.SetPreferred(_audio_bitrate, _audio_frame_duration, _audio_frames_per_packet);
+        audioBitrateApply();
+        return true;
+    }
+
+    void Mumlib2Private::AudioSetPassthrough(bool enabled)
+    {
+        _audio_passthrough = enabled;
+    }
+
+    bool Mumlib2Private::AudioSetPanning(bool enabled)
+    {
+        {
+            //checked together with the channel count a concurrent format change may write
+            std::lock_guard<std::mutex> lock(_audio_decoder_mutex);
+            if (enabled && _audio_output_channels != 2) {
+                return false;
+            }
+
+            _audio_panning = enabled;
+        }
+
+        //the panner is attached to the new decoder only, packets in flight finish with the old one
+        audioDecoderCreate();
+        return true;
+    }
+
+    void Mumlib2Private::AudioSetListener(const std::array<float, 3>& position, const std::array<float, 3>& forward)
+    {
+        _audio_panner.SetListener(position, forward);
+    }
+
+    void Mumlib2Private::AudioSetPosition(const std::optional<std::array<float, 3>>& position)
+    {
+        {
+            //read when the encoder is replaced, the encoder keeps its own copy under its position lock
+            std::lock_guard<std::mutex> lock(_audio_encoder_mutex);
+            _audio_position = position;
+            if (_audio_encoder) {
+                _audio_encoder->SetPosition(_audio_position);
+            }
+        }
+
+        _audio_bitrate_controller.SetPositional(position.has_value());
+        audioBitrateApply();
+    }
+
+    bool Mumlib2Private::AudioSetOutputFormat(AudioSampleFormat format, uint32_t channels)
+    {
+        //opus decodes to mono or stereo only
+        if (channels < 1 || channels > 2) {
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_audio_decoder_mutex);
+
+            //panning needs both channels
+            if (channels != 2) {
+                _audio_panning = false;
+            }
+
+            _audio_output_format = format;
+            _audio_output_channels = channels;
+        }
+
+        audioDecoderCreate();
+        return true;
+    }
+
+    bool Mumlib2Private::AudioSetInputSamplerate(uint32_t samplerate, ResamplerQuality quality)
+    {
+        if (samplerate < MUMBLE_RESAMPLER_SAMPLERATE_MIN || samplerate > MUMBLE_RESAMPLER_SAMPLERATE_MAX) {
+            return false;
+        }
+
+        _audio_input_samplerate = samplerate;
+        _audio_input_quality = quality;
+        audioEncoderCreate(_audio_input_samplerate, _audio_bitrate, _audio_input_quality, _audio_encoder_profile);
+        return true;
+    }
+
+    bool Mumlib2Private::AudioSetOutputSamplerate(uint32_t samplerate, ResamplerQuality quality)
+    {
+        if (samplerate < MUMBLE_RESAMPLER_SAMPLERATE_MIN || samplerate > MUMBLE_RESAMPLER_SAMPLERATE_MAX) {
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_audio_decoder_mutex);
+            _audio_output_samplerate = samplerate;
+            _audio_output_quality = quality;
+        }
+
+        audioDecoderCreate();
+        return true;
+    }
+
+    bool Mumlib2Private::AudioSetSendThread(bool enabled, const ThreadOptions& options)
+    {
+        if (!ThreadScheduler::Validate(options)) {
+            return false;
+        }
+
+        _audio_send_thread = enabled;
+        _audio_send_thread_options = options;
+        audioSenderCreate();
+        return true;
+    }
+
+    void Mumlib2Private::audioBitrateApply()
+    {
+        std::lock_guard<std::mutex> lock(_audio_encoder_mutex);
+        if (!_audio_encoder) {
+            return;
+        }
+
+        //both are picked up by the encoder at the next packet boundary
+        _audio_encoder->SetBitrate(_audio_bitrate_controller.GetBitrate());
+        _audio_encoder->SetFrameDuration(_audio_frame_duration, _audio_bitrate_controller.GetFramesPerPacket());
+    }
+
+    void Mumlib2Private::AudioSubscribeSession(int32_t session_id, bool subscribe)
+    {
+        _audio_subscription.Session(session_id, subscribe);
+    }
+
+    void Mumlib2Private::AudioSubscribeChannel(int32_t channel_id, bool subscribe)
+    {
+        _audio_subscription.Channel(channel_id, subscribe);
+    }
+
+    void Mumlib2Private::AudioSubscribePredicate(std::function<bool(const MumbleUser&)> predicate)
+    {
+        _audio_subscription.Predicate(std::move(predicate));
+    }
+
+    void Mumlib2Private::AudioSubscribeReset()
+    {
+        _audio_subscription.Reset();
+    }
+
+    bool Mumlib2Private::audioFrameDeliver(AudioPacket& packet, AudioDecoder& decoder)
+    {
+        std::shared_ptr<AudioFrameAllocator> allocator;
+        {
+            std::lock_guard<std::mutex> lock(_audio_frame_allocator_mutex);
+            allocator = _audio_frame_allocator;
+        }
+
+        if (!allocator) {
+            return false;
+        }
+
+        //frame is sized from the packet itself, the decoder writes straight into it
+        auto frame = AudioFrame::Create(
+            std::move(allocator),
+            decoder.GetFormat(),
+            decoder.GetChannels(),
+            decoder.GetSamplerate(),
+            decoder.GetOutputLength(packet));
+        if (!frame) {
+            return false;
+        }
+
+        size_t frames = 0;
+        if (frame.GetFormat() == AudioSampleFormat::FLOAT32) {
+            frames = decoder.ProcessInto(packet, frame.GetFloat(), frame.GetCapacity());
+        }
+        else {
+            frames = decoder.ProcessInto(packet, frame.GetInt16(), frame.GetCapacity());
+        }
+
+        frame.SetFrames(frames);
+        if (packet.GetAudioHasPosition()) {
+            frame.SetPosition(packet.GetAudioPosition());
+        }
+        frame.SetStream(
+            packet.GetHeaderTarget(),
+            static_cast<int32_t>(packet.GetAudioSessionId()),
+            packet.GetAudioSequenceNumber(),
+            packet.GetAudioLastFlag());
+
+        dispatch(DispatchClass::AUDIO, 0, "audioFrame", [frame](Callback& callback) {
+            callback.audioFrame(frame);
+        });
+        return true;
+    }
+
+    void Mumlib2Private::audioDecoderCreate()
+    {
+        //output settings are written under the same lock, concurrent setters end up with the last of them
+        std::lock_guard<std::mutex> lock(_audio_decoder_mutex);
+
+        //the io thread keeps the previous decoder alive until its packet is done
+        _audio_decoder = std::make_shared<AudioDecoder>(
+            _audio_output_channels,
+            _audio_output_samplerate,
+            _audio_output_quality,
+            _audio_output_format,
+            _audio_panning ? &_audio_panner : nullptr);
+    }
+
+    std::shared_ptr<AudioDecoder> Mumlib2Private::audioDecoderGet()
+    {
+        std::lock_guard<std::mutex> lock(_audio_decoder_mutex);
+        return _audio_decoder;
+    }
+
+    void Mumlib2Private::audioEncoderCreate(uint32_t input_samplerate, uint32_t output_bitrate, ResamplerQuality quality, const AudioEncoderProfile& profile)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_audio_encoder_mutex);
+
+            //sender keeps reference to the encoder
+            _audio_sender.reset();
+
+            _audio_encoder = std::make_unique<AudioEncoder>(input_samplerate, output_bitrate, quality, profile);
+            _audio_encoder->SetPosition(_audio_position);
+        }
+        audioBitrateApply();
+
+        audioSenderCreate();
+    }
+
+    void Mumlib2Private::audioSenderCreate()
+    {
+        std::lock_guard<std::mutex> lock(_audio_encoder_mutex);
+        _audio_sender.reset();
+
+        if (_audio_send_thread) {
+            _audio_sender = std::make_unique<AudioSender>(*_audio_encoder, [this](std::vector<uint8_t>&& packet) {
+                transportSendAudio(std::move(packet));
+            });
+            _audio_sender->Start(_audio_send_thread_options);
+        }
     }
 
     //
@@ -146,6 +482,39 @@ namespace mumlib2 {
         _channel_current = channel_id;
     }
 
+    //
+    // Dispatch
+    //
+    bool Mumlib2Private::DispatchSetOptions(const DispatchOptions& options)
+    {
+        if (!CallbackDispatcher::Validate(options)) {
+            return false;
+        }
+
+        //the io thread pushes without locking, the dispatcher can only be swapped while it is idle
+        if (TransportGetState() != ConnectionState::NOT_CONNECTED && TransportGetState() != ConnectionState::FAILED) {
+            return false;
+        }
+
+        if (options.queued) {
+            _dispatcher = std::make_unique<CallbackDispatcher>(_callback, options);
+        }
+        else {
+            _dispatcher.reset();
+        }
+
+        return true;
+    }
+
+    size_t Mumlib2Private::DispatchPump(std::chrono::milliseconds wait, size_t max_events)
+    {
+        if (!_dispatcher) {
+            return 0;
+        }
+
+        return _dispatcher->Pump(wait, max_events);
+    }
+
     //
     // General
     //
@@ -159,6 +528,8 @@ namespace mumlib2 {
         userClear();
 
         _server_maxbandwidth = 0;
+        _audio_bitrate_controller.Reset();
+        audioBitrateApply();
         _server_allowhtml = 0;
         _server_imagemessagelength = 0;
         _server_messagelength = 0;
@@ -170,6 +541,8 @@ namespace mumlib2 {
 	//
     bool Mumlib2Private::processControlPacket(MessageType messageType, const uint8_t* buffer, int length)
     {
+        MUMLIB2_TRACE_SCOPE("Mumlib2Private::processControlPacket", CONTROL);
+
         switch (messageType) {
         case MessageType::VERSION:
             return processControlVersionPacket(buffer, length);
@@ -180,8 +553,7 @@ namespace mumlib2 {
             _logger.warn("Mumlib2Private::processControlPacket() -> AUTHENTICATE not implemented");
             break;
         case MessageType::PING:
-            _logger.warn("Mumlib2Private::processControlPacket() -> PING not implemented");
-            break;
+            return processControlPingPacket(buffer, length);
         case MessageType::REJECT:
             _logger.warn("Mumlib2Private::processControlPacket() -> PING not implemented");
             break;
@@ -238,7 +610,9 @@ namespace mumlib2 {
             _logger.warn("Mumlib2Private::processControlPacket() -> SUGGESTCONFIG not implemented");
             break;
         default:
-            throw Mumlib2Exception("Mumlib2Private::processControlPacket() -> unknown message type: " + to_string(static_cast<int>(messageType)));
+            //newer servers may send messages we do not know yet
+            _logger.warn("Mumlib2Private::processControlPacket() -> unknown message type: %d", static_cast<int>(messageType));
+            break;
         }
 
         return false;
@@ -255,15 +629,17 @@ namespace mumlib2 {
             auto ip_data_size = ban.address().size();
             auto duration = ban.has_duration() ? ban.duration() : -1;
 
-            _callback.banList(
-                ip_data,
-                ip_data_size,
-                ban.mask(),
-                ban.name(),
-                ban.hash(),
-                ban.reason(),
-                ban.start(),
-                duration);
+            dispatch(DispatchClass::CONTROL, 0, "banList", [ip = std::vector<uint8_t>(ip_data, ip_data + ip_data_size), ban, duration](Callback& callback) {
+                callback.banList(
+                    ip.data(),
+                    static_cast<uint32_t>(ip.size()),
+                    ban.mask(),
+                    ban.name(),
+                    ban.hash(),
+                    ban.reason(),
+                    ban.start(),
+                    duration);
+            });
         }
 
         return true;
@@ -278,7 +654,9 @@ namespace mumlib2 {
             channelErase(channelRemove.channel_id());
         }
 
-        _callback.channelRemove(channelRemove.channel_id());
+        dispatch(DispatchClass::CONTROL, 0, "channelRemove", [channel_id = channelRemove.channel_id()](Callback& callback) {
+            callback.channelRemove(channel_id);
+        });
         return true;
     }
 
@@ -317,17 +695,19 @@ namespace mumlib2 {
             channelEmplace(mumbleChannel);
         }
 
-        _callback.channelState(
-            channelState.name(),
-            channel_id,
-            parent,
-            channelState.description(),
-            links,
-            links_add,
-            links_remove,
-            temporary,
-            position
-        );
+        dispatch(DispatchClass::CONTROL, 0, "channelState", [=, name = channelState.name(), description = channelState.description()](Callback& callback) {
+            callback.channelState(
+                name,
+                channel_id,
+                parent,
+                description,
+                links,
+                links_add,
+                links_remove,
+                temporary,
+                position
+            );
+        });
 
         return true;
     }
@@ -342,7 +722,9 @@ namespace mumlib2 {
         uint32_t prefer_alpha = codecVersion.prefer_alpha();
         int32_t opus = codecVersion.has_opus() ? codecVersion.opus() : 0;
 
-        _callback.codecVersion(alpha, beta, prefer_alpha, opus);
+        dispatch(DispatchClass::STATE, dispatchKey(DispatchKey::CODEC_VERSION, 0), "codecVersion", [=](Callback& callback) {
+            callback.codecVersion(alpha, beta, prefer_alpha, opus);
+        });
 
         return true;
     }
@@ -355,7 +737,9 @@ namespace mumlib2 {
 		uint32_t onlineSecs = userStats.onlinesecs();
         uint32_t idleSecs = userStats.idlesecs();
 
-        _callback.userStats(sessionId, onlineSecs, idleSecs);
+        dispatch(DispatchClass::STATE, dispatchKey(DispatchKey::USER_STATS, sessionId), "userStats", [=](Callback& callback) {
+            callback.userStats(sessionId, onlineSecs, idleSecs);
+        });
 		
 		return true;
     }
@@ -369,7 +753,11 @@ namespace mumlib2 {
         uint32_t permissions = permissionQuery.has_permissions() ? permissionQuery.permissions() : 0;
         uint32_t flush = permissionQuery.has_flush() ? permissionQuery.flush() : -1;
 
-        _callback.permissionQuery(channel_id, permissions, flush);
+        //a flush drops every cached permission, it must not be replaced by a later query
+        auto type = permissionQuery.flush() ? DispatchClass::CONTROL : DispatchClass::STATE;
+        dispatch(type, dispatchKey(DispatchKey::PERMISSION_QUERY, channel_id), "permissionQuery", [=](Callback& callback) {
+            callback.permissionQuery(channel_id, permissions, flush);
+        });
 
         return true;
     }
@@ -396,7 +784,9 @@ namespace mumlib2 {
             tree_ids.push_back(text_message.tree_id(i));
         }
 
-        _callback.textMessage(actor, sessions, channel_ids, tree_ids, text_message.message());
+        dispatch(DispatchClass::CONTROL, 0, "textMessage", [=, message = text_message.message()](Callback& callback) {
+            callback.textMessage(actor, sessions, channel_ids, tree_ids, message);
+        });
 
         return true;
     }
@@ -405,13 +795,15 @@ namespace mumlib2 {
     {
         MumbleProto::Version version;
         version.ParseFromArray(buffer, length);
-        _callback.version(
-            version.version() >> 16,
-            version.version() >> 8 & 0xff,
-            version.version() & 0xff,
-            version.release(),
-            version.os(),
-            version.os_version());
+        dispatch(DispatchClass::CONTROL, 0, "version", [version](Callback& callback) {
+            callback.version(
+                version.version() >> 16,
+                version.version() >> 8 & 0xff,
+                version.version() & 0xff,
+                version.release(),
+                version.os(),
+                version.os_version());
+        });
 
         return true;
     }
@@ -428,12 +820,14 @@ namespace mumlib2 {
             userErase(user_remove.session());
         }
 
-        _callback.userRemove(
-            user_remove.session(),
-            actor,
-            user_remove.reason(),
-            ban
-        );
+        dispatch(DispatchClass::CONTROL, 0, "userRemove", [=, session = user_remove.session(), reason = user_remove.reason()](Callback& callback) {
+            callback.userRemove(
+                session,
+                actor,
+                reason,
+                ban
+            );
+        });
 
         return true;
     }
@@ -457,7 +851,7 @@ namespace mumlib2 {
         int32_t recording = userState.has_recording() ? userState.recording() : -1;
 
         //update current channel
-        if (session == sessionGet()) {
+        if (session == sessionGet() && channel_id >= 0) {
             channelSet(channel_id);
         }
 
@@ -470,19 +864,40 @@ namespace mumlib2 {
 
         userUpdate(mumbleUser);
 
-        _callback.userState(session,
-            actor,
-            userState.name(),
-            user_id,
-            channel_id,
-            mute,
-            deaf,
-            suppress,
-            self_mute,
-            self_deaf,
-            userState.comment(),
-            priority_speaker,
-            recording);
+        dispatch(DispatchClass::CONTROL, 0, "userState", [=, name = userState.name(), comment = userState.comment()](Callback& callback) {
+            callback.userState(session,
+                actor,
+                name,
+                user_id,
+                channel_id,
+                mute,
+                deaf,
+                suppress,
+                self_mute,
+                self_deaf,
+                comment,
+                priority_speaker,
+                recording);
+        });
+
+        return true;
+    }
+
+    bool Mumlib2Private::processControlPingPacket(const uint8_t* buffer, int length)
+    {
+        //transport already parsed the ping and updated its statistics
+        if (!_transport) {
+            return false;
+        }
+
+        auto& crypt_state = _transport->getCryptState();
+        _audio_bitrate_controller.SetTunnel(!_transport->isUdpActive());
+        _audio_bitrate_controller.Update(
+            crypt_state.getRemoteGood(),
+            crypt_state.getRemoteLate(),
+            crypt_state.getRemoteLost(),
+            _transport->getPingRtt());
+        audioBitrateApply();
 
         return true;
     }
@@ -498,12 +913,19 @@ namespace mumlib2 {
         _server_imagemessagelength = serverConfig.has_image_message_length() ? serverConfig.image_message_length() : 0;
         _server_messagelength = serverConfig.has_message_length() ? serverConfig.message_length() : 0;
 
-        _callback.serverConfig(
-            _server_maxbandwidth, 
-            _server_welcometext, 
-            _server_allowhtml, 
-            _server_messagelength,
-            _server_imagemessagelength);
+        _audio_bitrate_controller.SetServerMaxBandwidth(_server_maxbandwidth);
+        audioBitrateApply();
+
+        dispatch(DispatchClass::STATE, dispatchKey(DispatchKey::SERVER_CONFIG, 0), "serverConfig",
+            [max_bandwidth = _server_maxbandwidth, welcome_text = _server_welcometext, allow_html = _server_allowhtml,
+                message_length = _server_messagelength, image_message_length = _server_imagemessagelength](Callback& callback) {
+            callback.serverConfig(
+                max_bandwidth,
+                welcome_text,
+                allow_html,
+                message_length,
+                image_message_length);
+        });
 
         return true;
     }
@@ -515,48 +937,191 @@ namespace mumlib2 {
 
         _session_id = serverSync.session();
 
-        _callback.serverSync(
-            serverSync.welcome_text(),
-            serverSync.session(),
-            serverSync.max_bandwidth(),
-            serverSync.permissions()
-        );
+        //our own user state arrived before the session id was known
+        if (_user_map.contains(_session_id) && _user_map[_session_id].channelId >= 0) {
+            channelSet(_user_map[_session_id].channelId);
+        }
+
+        sessionRestore();
+
+        if (serverSync.has_max_bandwidth()) {
+            _server_maxbandwidth = serverSync.max_bandwidth();
+            _audio_bitrate_controller.SetServerMaxBandwidth(_server_maxbandwidth);
+            audioBitrateApply();
+        }
+
+        dispatch(DispatchClass::CONTROL, 0, "serverSync", [serverSync](Callback& callback) {
+            callback.serverSync(
+                serverSync.welcome_text(),
+                serverSync.session(),
+                serverSync.max_bandwidth(),
+                serverSync.permissions()
+            );
+        });
 
         return true;
     }
 
+    void Mumlib2Private::processTransportError(const std::error_code& error)
+    {
+        _logger.warn("Mumlib2Private::processTransportError() -> %s", error.message().c_str());
+        dispatch(DispatchClass::CONTROL, 0, "transportError", [error](Callback& callback) {
+            callback.transportError(error);
+        });
+    }
+
+    void Mumlib2Private::processTransportUdpState(bool active)
+    {
+        //tunnel headers are larger, bitrate is refitted for the new path
+        _audio_bitrate_controller.SetTunnel(!active);
+        audioBitrateApply();
+
+        dispatch(DispatchClass::STATE, dispatchKey(DispatchKey::UDP_STATE, 0), "udpState", [active](Callback& callback) {
+            callback.udpState(active);
+        });
+    }
+
+    void Mumlib2Private::processTransportState(ConnectionState state)
+    {
+        if (state == ConnectionState::RECONNECTING) {
+            //session ids change with the new connection, the registry is rebuilt from what the server sends
+            if (_session_id) {
+                _channel_restore = _channel_current;
+            }
+
+            generalClear();
+            audioDecoderCreate();
+        }
+
+        dispatch(DispatchClass::CONTROL, 0, "connectionState", [state](Callback& callback) {
+            callback.connectionState(state);
+        });
+    }
+
 	bool Mumlib2Private::processAudioPacket(AudioPacket& packet)
 	{
+        //network timing is measured for every speaker, before local decisions drop anything
+        if (packet.GetHeaderType() == AudioPacketType::Opus) {
+            _audio_arrival.Update(packet.GetAudioSessionId(), packet.GetAudioSequenceNumber(), packet.GetReceiveTime(), packet.GetReceiveTimeKernel());
+        }
+
         //check for mute
         if (UserMuted(packet.GetAudioSessionId())) {
             return true;
         }
 
+        //setters may replace the decoder from user threads, the whole packet goes through this one
+        auto decoder = audioDecoderGet();
+
+        //check subscription before any decoding work
         if (packet.GetHeaderType() == AudioPacketType::Opus) {
-            auto [buf, len] = _audio_decoder->Process(packet);
-            _callback.audio(
-                packet.GetHeaderTarget(),
-                packet.GetAudioSessionId(),
-                packet.GetAudioSequenceNumber(),
-                packet.GetAudioLastFlag(),
-                buf,
-                len
-            );
+            bool subscribed = _audio_subscription.Check(packet.GetAudioSessionId(), [this](int32_t session_id) {
+                return UserGet(session_id);
+            });
+
+            if (!subscribed) {
+                decoder->Skip(packet);
+                return true;
+            }
+        }
+
+        if (packet.GetAudioHasPosition()) {
+            dispatch(DispatchClass::AUDIO, 0, "audioPosition", [target = packet.GetHeaderTarget(), session_id = packet.GetAudioSessionId(),
+                sequence_number = packet.GetAudioSequenceNumber(), position = packet.GetAudioPosition()](Callback& callback) {
+                callback.audioPosition(
+                    target,
+                    session_id,
+                    sequence_number,
+                    position[0],
+                    position[1],
+                    position[2]
+                );
+            });
+        }
+
+        if (packet.GetHeaderType() == AudioPacketType::Opus && _audio_passthrough) {
+            const auto& payload = packet.GetAudioPayload();
+            if (_dispatcher) {
+                dispatch(DispatchClass::AUDIO, 0, "encodedAudio", [target = packet.GetHeaderTarget(), session_id = packet.GetAudioSessionId(),
+                    sequence_number = packet.GetAudioSequenceNumber(), is_last = packet.GetAudioLastFlag(),
+                    data = payload](Callback& callback) {
+                    callback.encodedAudio(target, session_id, sequence_number, is_last, data.data(), data.size());
+                });
+            }
+            else {
+                MUMLIB2_TRACE_SCOPE("encodedAudio", USER_CALLBACK);
+                _callback.encodedAudio(
+                    packet.GetHeaderTarget(),
+                    packet.GetAudioSessionId(),
+                    packet.GetAudioSequenceNumber(),
+                    packet.GetAudioLastFlag(),
+                    payload.data(),
+                    payload.size()
+                );
+            }
+        }
+        else if (packet.GetHeaderType() == AudioPacketType::Opus && audioFrameDeliver(packet, *decoder)) {
+            //delivered as frame handle
+        }
+        else if (packet.GetHeaderType() == AudioPacketType::Opus && decoder->GetFormat() == AudioSampleFormat::FLOAT32) {
+            auto [buf, len] = decoder->ProcessFloat(packet);
+            if (_dispatcher) {
+                //decoder buffer is reused by the next packet, queued calls need their own copy
+                dispatch(DispatchClass::AUDIO, 0, "audioFloat", [target = packet.GetHeaderTarget(), session_id = packet.GetAudioSessionId(),
+                    sequence_number = packet.GetAudioSequenceNumber(), is_last = packet.GetAudioLastFlag(),
+                    samples = std::vector<float>(buf, buf + len * decoder->GetChannels()), len, channels = decoder->GetChannels()](Callback& callback) {
+                    callback.audioFloat(target, session_id, sequence_number, is_last, samples.data(), len, channels);
+                });
+            }
+            else {
+                MUMLIB2_TRACE_SCOPE("audioFloat", USER_CALLBACK);
+                _callback.audioFloat(
+                    packet.GetHeaderTarget(),
+                    packet.GetAudioSessionId(),
+                    packet.GetAudioSequenceNumber(),
+                    packet.GetAudioLastFlag(),
+                    buf,
+                    len,
+                    decoder->GetChannels()
+                );
+            }
+        }
+        else if (packet.GetHeaderType() == AudioPacketType::Opus) {
+            auto [buf, len] = decoder->Process(packet);
+            if (_dispatcher) {
+                dispatch(DispatchClass::AUDIO, 0, "audio", [target = packet.GetHeaderTarget(), session_id = packet.GetAudioSessionId(),
+                    sequence_number = packet.GetAudioSequenceNumber(), is_last = packet.GetAudioLastFlag(),
+                    samples = std::vector<int16_t>(buf, buf + len * decoder->GetChannels()), len](Callback& callback) {
+                    callback.audio(target, session_id, sequence_number, is_last, samples.data(), len);
+                });
+            }
+            else {
+                MUMLIB2_TRACE_SCOPE("audio", USER_CALLBACK);
+                _callback.audio(
+                    packet.GetHeaderTarget(),
+                    packet.GetAudioSessionId(),
+                    packet.GetAudioSequenceNumber(),
+                    packet.GetAudioLastFlag(),
+                    buf,
+                    len
+                );
+            }
         }
         else if (packet.GetHeaderType() == AudioPacketType::Ping) {
             //TODO: callback for ping
         }
         else {
             _logger.warn("Mumlib2Private::processAudioPacket() -> codec not implemented");
-            _callback.unsupportedAudio(
-                packet.GetHeaderTarget(),
-                packet.GetAudioSessionId(),
-                packet.GetAudioSequenceNumber(),
-                packet.GetAudioPayload().data(),
-                packet.GetAudioPayload().size()
-            );
+            const auto& payload = packet.GetAudioPayload();
+            dispatch(DispatchClass::AUDIO, 0, "unsupportedAudio", [target = packet.GetHeaderTarget(), session_id = packet.GetAudioSessionId(),
+                sequence_number = packet.GetAudioSequenceNumber(), data = payload](Callback& callback) {
+                callback.unsupportedAudio(target, session_id, sequence_number, data.data(), data.size());
+            });
         }
 
+        //with queued dispatch this ends when the audio is queued, not when it is consumed
+        _audio_arrival.UpdateProcessing(packet.GetAudioSessionId(), std::chrono::system_clock::now() - packet.GetReceiveTime());
+
         return true;
 	}
 
@@ -614,6 +1179,14 @@ namespace mumlib2 {
         if (_user_map.contains(user.sessionId)) {
             user.local_mute = _user_map[user.sessionId].local_mute;
             user.name = _user_map[user.sessionId].name;
+
+            //channel is only sent when it changes
+            if (user.channelId < 0) {
+                user.channelId = _user_map[user.sessionId].channelId;
+            }
+        }
+        else if (_user_muted_names.contains(user.name)) {
+            user.local_mute = true;
         }
 
         _user_map[user.sessionId] = user;
@@ -622,6 +1195,7 @@ namespace mumlib2 {
     void Mumlib2Private::userClear()
     {
         _user_map.clear();
+        _audio_arrival.Clear();
     }
 
     void Mumlib2Private::userErase(uint32_t user_id)
@@ -629,6 +1203,7 @@ namespace mumlib2 {
         if (_user_map.contains(user_id)) {
             _user_map.erase(user_id);
         }
+        _audio_arrival.Erase(user_id);
     }
 
     int32_t Mumlib2Private::UserFind(const std::string& user_name) const
@@ -648,8 +1223,20 @@ namespace mumlib2 {
             return false;
         }
 
-        _user_map[user_id].local_mute = mute_state;
-        return true;;
+        auto& user = _user_map[user_id];
+        user.local_mute = mute_state;
+
+        //kept by name, session ids change when reconnecting
+        if (!user.name.empty()) {
+            if (mute_state) {
+                _user_muted_names.insert(user.name);
+            }
+            else {
+                _user_muted_names.erase(user.name);
+            }
+        }
+
+        return true;
     }
 
     bool Mumlib2Private::UserSendState(UserState field, bool val)
@@ -742,6 +1329,59 @@ namespace mumlib2 {
         return _session_id;
     }
 
+    void Mumlib2Private::sessionRestore()
+    {
+        //back to the channel we were in before reconnecting
+        if (_channel_restore.has_value()) {
+            if (*_channel_restore != _channel_current && ChannelExists(*_channel_restore)) {
+                ChannelJoin(*_channel_restore);
+            }
+            _channel_restore.reset();
+        }
+
+        //voice targets live on the server side of the connection
+        for (const auto& voicetarget : _voicetargets) {
+            voicetargetSend(voicetarget.first);
+        }
+    }
+
+
+    //
+    // Statistics
+    //
+    Statistics Mumlib2Private::StatisticsGet()
+    {
+        Statistics statistics;
+
+        //senders take the encoder lock before the transport lock, same order here
+        {
+            std::lock_guard<std::mutex> lock(_audio_encoder_mutex);
+            if (_audio_sender) {
+                statistics.audio_send_deadline_misses = _audio_sender->GetDeadlineMisses();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(_transport_mutex);
+        if (_transport) {
+            _transport->getStatistics(statistics);
+        }
+
+        if (_dispatcher) {
+            _dispatcher->GetStatistics(statistics);
+        }
+
+#if defined(MUMLIB2_TRACING)
+        statistics.trace_slow_callbacks = Tracer::Instance().GetSlowCallbacks();
+#endif
+
+        return statistics;
+    }
+
+    std::vector<SpeakerStatistics> Mumlib2Private::StatisticsGetSpeakers()
+    {
+        return _audio_arrival.Get();
+    }
+
 
     //
     // Text
@@ -768,13 +1408,24 @@ namespace mumlib2 {
 	{
         if (TransportGetState() == ConnectionState::CONNECTED ||
             TransportGetState() == ConnectionState::IN_PROGRESS ||
-            TransportGetState() == ConnectionState::DISCONNECTING) {
+            TransportGetState() == ConnectionState::DISCONNECTING ||
+            TransportGetState() == ConnectionState::RECONNECTING) {
             return false;
         }
 
+		//disconnected from a callback, the transport goes away once run() returns
+		if (_transport_release) {
+			if (_transport && _transport->isIoThread()) {
+				return false;
+			}
+			std::lock_guard<std::mutex> lock(_transport_run_mutex);
+		}
+
         generalClear();
 
-		if (!_transport) {
+		//a failed transport has its sockets torn down, start over
+		if (!_transport || TransportGetState() == ConnectionState::FAILED) {
+			transportThreadJoin();
 			transportCreate();
 		}
 		_transport->connect(host, port, user, password);
@@ -783,12 +1434,39 @@ namespace mumlib2 {
 
 	void Mumlib2Private::TransportDisconnect()
 	{
+		//called from a callback, run() is still on the stack and releases the transport when it returns
+		if (_transport && _transport->isIoThread()) {
+			_transport->disconnect();
+			_transport_release = true;
+			return;
+		}
+
+		//a disconnect from a callback is still releasing it
+		if (_transport_release) {
+			std::lock_guard<std::mutex> lock(_transport_run_mutex);
+		}
+
+		//the caller may be the only consumer, a full queue would keep the io thread from stopping
+		if (_dispatcher) {
+			_dispatcher->SetBlocking(false);
+		}
+
+		//posted to the io thread, it stops io and run() returns
 		if (_transport) {
 			_transport->disconnect();
 		}
-		_transport.reset();
 
-        generalClear();
+		//owned thread is joined, run() on an application thread is waited for
+		transportThreadJoin();
+		{
+			std::lock_guard<std::mutex> lock(_transport_run_mutex);
+		}
+
+		if (_dispatcher) {
+			_dispatcher->SetBlocking(true);
+		}
+
+		transportRelease();
 	}
 
 	ConnectionState Mumlib2Private::TransportGetState() const
@@ -800,28 +1478,115 @@ namespace mumlib2 {
 		return _transport->getConnectionState();
 	}
 
+	void Mumlib2Private::TransportSetReconnect(bool enabled, uint32_t delay_min_ms, uint32_t delay_max_ms)
+	{
+		_transport_reconnect = enabled;
+		_transport_reconnect_min = delay_min_ms;
+		_transport_reconnect_max = delay_max_ms;
+	}
+
+	bool Mumlib2Private::TransportSetOptions(const TransportOptions& options)
+	{
+		if (options.dscp > 63) {
+			return false;
+		}
+
+		_transport_options = options;
+		return true;
+	}
+
+	std::error_code Mumlib2Private::TransportGetError()
+	{
+		std::lock_guard<std::mutex> lock(_transport_mutex);
+		if (!_transport) {
+			return {};
+		}
+
+		return _transport->getLastError();
+	}
+
 	void Mumlib2Private::TransportRun()
 	{
+		std::lock_guard<std::mutex> lock(_transport_run_mutex);
 		_transport->run();
+
+		//disconnect() was called from a callback, the transport is off the stack now
+		if (_transport_release.exchange(false)) {
+			transportRelease();
+		}
+	}
+
+	bool Mumlib2Private::TransportRunThread(const ThreadOptions& options)
+	{
+		if (!_transport || _transport_thread.joinable() || !ThreadScheduler::Validate(options)) {
+			return false;
+		}
+
+		_transport_thread = std::thread([this, options]() {
+			ThreadScheduler::Apply(options, _logger);
+			TransportRun();
+		});
+		return true;
+	}
+
+	void Mumlib2Private::transportRelease()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_transport_mutex);
+			_transport.reset();
+		}
+
+		generalClear();
+	}
+
+	void Mumlib2Private::transportThreadJoin()
+	{
+		//callbacks run on the io thread and may disconnect from there
+		if (_transport_thread.joinable() && _transport_thread.get_id() != std::this_thread::get_id()) {
+			_transport_thread.join();
+		}
 	}
 
 	void Mumlib2Private::TransportSetCert(const std::string& cert)
 	{
 		_transport_cert = cert;
+		_transport_tls_context.reset();
 	}
 
 	void Mumlib2Private::TransportSetKey(const std::string& key)
 	{
 		_transport_key = key;
+		_transport_tls_context.reset();
+	}
+
+	void Mumlib2Private::TransportSetTlsContext(std::shared_ptr<TlsContext> context)
+	{
+		_transport_tls_context = std::move(context);
 	}
 
 	void Mumlib2Private::transportCreate()
 	{
+		std::lock_guard<std::mutex> lock(_transport_mutex);
+
+		//parsed once and kept, later transports resume the sessions cached in it
+		if (!_transport_tls_context) {
+			_transport_tls_context = TlsContext::FromFiles(_transport_cert, _transport_key);
+		}
+
 		_transport = std::make_unique<Transport>(
 			std::bind(&Mumlib2Private::processControlPacket, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
 			std::bind(&Mumlib2Private::processAudioPacket, this, std::placeholders::_1),
-			_transport_cert,
-			_transport_key);
+			std::bind(&Mumlib2Private::processTransportError, this, std::placeholders::_1),
+			std::bind(&Mumlib2Private::processTransportState, this, std::placeholders::_1),
+			std::bind(&Mumlib2Private::processTransportUdpState, this, std::placeholders::_1),
+			_transport_tls_context);
+
+		_transport->setAuthTokens(_acl_tokens);
+		_transport->setReconnect(
+			_transport_reconnect,
+			std::chrono::milliseconds(_transport_reconnect_min),
+			std::chrono::milliseconds(_transport_reconnect_max));
+		_transport->setOptions(_transport_options);
 	}
 
     bool Mumlib2Private::transportSendAuthentication(const std::vector<std::string>& tokens)
@@ -844,13 +1609,15 @@ namespace mumlib2 {
         return true;
     }
 
-    bool Mumlib2Private::transportSendAudio(const uint8_t* data, size_t len)
+    bool Mumlib2Private::transportSendAudio(std::vector<uint8_t>&& packet)
     {
+        //called from user or audio send threads, actual send happens on the io thread
+        std::lock_guard<std::mutex> lock(_transport_mutex);
         if (!_transport) {
             return false;
         }
 
-        _transport->sendEncodedAudioPacket(data, len);
+        _transport->postEncodedAudioPacket(std::move(packet));
         return true;
     }
 
@@ -860,23 +1627,55 @@ namespace mumlib2 {
 
     bool Mumlib2Private::VoicetargetSet(int targetId, VoiceTargetType type, int id)
     {
-        MumbleProto::VoiceTarget_Target voiceTargetTarget;
-        
+        VoicetargetEntry entry{ type, id, "" };
+
         switch (type) {
-            case VoiceTargetType::CHANNEL: 
-                voiceTargetTarget.set_channel_id(id);
-                voiceTargetTarget.set_children(true);
+            case VoiceTargetType::CHANNEL:
                 break;
             case VoiceTargetType::USER:
-                voiceTargetTarget.add_session(id);
+                if (_user_map.contains(id)) {
+                    entry.user_name = _user_map[id].name;
+                }
                 break;
             default:
                 return false;
         }
-        _voiceTarget.set_id(targetId);
-        _voiceTarget.add_targets()->CopyFrom(voiceTargetTarget);
-        
-        if (!transportSendControl(MessageType::VOICETARGET, _voiceTarget)) {
+
+        _voicetargets[targetId].push_back(entry);
+
+        return voicetargetSend(targetId);
+    }
+
+    bool Mumlib2Private::voicetargetSend(int targetId)
+    {
+        MumbleProto::VoiceTarget voiceTarget;
+        voiceTarget.set_id(targetId);
+
+        for (auto& entry : _voicetargets[targetId]) {
+            MumbleProto::VoiceTarget_Target voiceTargetTarget;
+
+            switch (entry.type) {
+                case VoiceTargetType::CHANNEL:
+                    voiceTargetTarget.set_channel_id(entry.id);
+                    voiceTargetTarget.set_children(true);
+                    break;
+                case VoiceTargetType::USER: {
+                    int32_t session_id = entry.user_name.empty() ? entry.id : UserFind(entry.user_name);
+                    if (session_id < 0) {
+                        continue;
+                    }
+                    entry.id = session_id;
+                    voiceTargetTarget.add_session(session_id);
+                    break;
+                }
+                default:
+                    continue;
+            }
+
+            voiceTarget.add_targets()->CopyFrom(voiceTargetTarget);
+        }
+
+        if (!transportSendControl(MessageType::VOICETARGET, voiceTarget)) {
             return false;
         }
         return true;
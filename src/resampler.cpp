@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//stdlib
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <type_traits>
+
+//simd
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MUMLIB2_RESAMPLER_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MUMLIB2_RESAMPLER_NEON
+#include <arm_neon.h>
+#endif
+
+//mumlib
+#include "mumlib2/exceptions.h"
+#include "mumlib2_private/resampler.h"
+
+namespace mumlib2 {
+
+    namespace {
+        struct ResamplerPreset {
+            size_t zero_crossings;
+            double rolloff;
+        };
+
+        constexpr ResamplerPreset resamplerPreset(ResamplerQuality quality)
+        {
+            switch (quality) {
+            case ResamplerQuality::FAST:
+                return { 8, 0.80 };
+            case ResamplerQuality::HIGH:
+                return { 32, 0.94 };
+            case ResamplerQuality::BEST:
+                return { 64, 0.96 };
+            case ResamplerQuality::MEDIUM:
+            default:
+                return { 16, 0.90 };
+            }
+        }
+
+        //taps are padded so the dot product never needs a scalar tail
+        constexpr size_t taps_alignment = 8;
+
+        //history is sized for the longest Opus packet, larger blocks grow it once
+        constexpr size_t history_block_ms = 120;
+    }
+
+    //
+    // Ctor
+    //
+
+    Resampler::Resampler(uint32_t input_samplerate, uint32_t output_samplerate, uint32_t channels, ResamplerQuality quality)
+    {
+        if (!input_samplerate || !output_samplerate || !channels) {
+            throw Mumlib2Exception("Resampler: invalid parameters");
+        }
+
+        auto divisor = std::gcd(input_samplerate, output_samplerate);
+        _interpolation = output_samplerate / divisor;
+        _decimation = input_samplerate / divisor;
+        _phases = std::min(_interpolation, _phases_max);
+        _channels = channels;
+
+        if (!IsPassthrough()) {
+            createFilter(quality);
+            historyResize(_taps + static_cast<size_t>(input_samplerate) * history_block_ms / 1000);
+        }
+
+        Reset();
+    }
+
+    //
+    // Public
+    //
+
+    bool Resampler::IsPassthrough() const
+    {
+        return _interpolation == _decimation;
+    }
+
+    size_t Resampler::GetOutputLength(size_t input_frames) const
+    {
+        return (input_frames * _interpolation + _decimation - 1) / _decimation + 1;
+    }
+
+    size_t Resampler::Process(const int16_t* input, size_t input_frames, int16_t* output, size_t output_frames)
+    {
+        return process(input, input_frames, output, output_frames);
+    }
+
+    size_t Resampler::Process(const float* input, size_t input_frames, float* output, size_t output_frames)
+    {
+        //filter is linear, float samples go through unscaled
+        return process(input, input_frames, output, output_frames);
+    }
+
+    void Resampler::Reset()
+    {
+        //prime the whole filter span, so each block yields exactly ratio * input frames
+        std::fill(_history.begin(), _history.end(), 0.0f);
+        _history_start = 0;
+        _history_fill = _taps ? _taps - 1 : 0;
+        _index = 0;
+        _phase = 0;
+    }
+
+    //
+    // Private
+    //
+
+    void Resampler::createFilter(ResamplerQuality quality)
+    {
+        auto preset = resamplerPreset(quality);
+
+        //when decimating the passband shrinks and the filter must get longer to keep the same steepness
+        double ratio = std::min(1.0, static_cast<double>(_interpolation) / _decimation);
+        double cutoff = ratio * preset.rolloff;
+        size_t half = static_cast<size_t>(std::ceil(preset.zero_crossings / ratio));
+
+        _taps = (2 * half + taps_alignment - 1) / taps_alignment * taps_alignment;
+        size_t delay = half - 1;
+
+        //one extra phase at a full sample offset, so interpolation never needs to wrap
+        _filter.assign((_phases + 1) * _taps, 0.0f);
+
+        for (uint32_t phase = 0; phase <= _phases; phase++) {
+            float* coefficients = &_filter[phase * _taps];
+            double sum = 0.0;
+
+            for (size_t tap = 0; tap < _taps; tap++) {
+                double t = static_cast<double>(tap) - delay - static_cast<double>(phase) / _phases;
+                if (std::abs(t) >= half) {
+                    continue;
+                }
+
+                double x = M_PI * cutoff * t;
+                double sinc = (x == 0.0) ? 1.0 : std::sin(x) / x;
+                double window = 0.42 + 0.5 * std::cos(M_PI * t / half) + 0.08 * std::cos(2.0 * M_PI * t / half);
+
+                coefficients[tap] = static_cast<float>(cutoff * sinc * window);
+                sum += coefficients[tap];
+            }
+
+            //unity gain for every phase
+            for (size_t tap = 0; tap < _taps; tap++) {
+                coefficients[tap] = static_cast<float>(coefficients[tap] / sum);
+            }
+        }
+    }
+
+    template <typename T>
+    size_t Resampler::process(const T* input, size_t input_frames, T* output, size_t output_frames)
+    {
+        if (IsPassthrough()) {
+            auto frames = std::min(input_frames, output_frames);
+            std::memcpy(output, input, frames * _channels * sizeof(T));
+            return frames;
+        }
+
+        if (_history_fill + input_frames > _history_capacity) {
+            historyResize(_history_fill + input_frames);
+        }
+
+        //deinterleave into per-channel rings, both copies are written so a window never wraps
+        for (uint32_t channel = 0; channel < _channels; channel++) {
+            float* history = historyChannel(channel);
+            size_t position = (_history_start + _history_fill) % _history_capacity;
+            for (size_t frame = 0; frame < input_frames; frame++) {
+                float sample = input[frame * _channels + channel];
+                history[position] = sample;
+                history[position + _history_capacity] = sample;
+                if (++position == _history_capacity) {
+                    position = 0;
+                }
+            }
+        }
+        _history_fill += input_frames;
+
+        const size_t available = _history_fill;
+        size_t produced = 0;
+
+        while (_index + _taps <= available && produced < output_frames) {
+            //exact phase when the ratio fits the table, otherwise blend the two nearest ones
+            uint64_t position = static_cast<uint64_t>(_phase) * _phases;
+            uint32_t phase = static_cast<uint32_t>(position / _interpolation);
+            float fraction = static_cast<float>(position % _interpolation) / _interpolation;
+
+            const float* coefficients = &_filter[phase * _taps];
+            for (uint32_t channel = 0; channel < _channels; channel++) {
+                const float* window = historyChannel(channel) + _history_start + _index;
+                float sample = dot(window, coefficients, _taps);
+                if (fraction > 0.0f) {
+                    sample += fraction * (dot(window, coefficients + _taps, _taps) - sample);
+                }
+                if constexpr (std::is_same_v<T, float>) {
+                    output[produced * _channels + channel] = sample;
+                }
+                else {
+                    output[produced * _channels + channel] = static_cast<int16_t>(std::clamp(std::lrint(sample), -32768L, 32767L));
+                }
+            }
+            produced++;
+
+            _phase += _decimation;
+            _index += _phase / _interpolation;
+            _phase %= _interpolation;
+        }
+
+        //drop consumed input, keep the filter tail
+        auto consumed = std::min(_index, available);
+        _history_start = (_history_start + consumed) % _history_capacity;
+        _history_fill -= consumed;
+        _index -= consumed;
+
+        return produced;
+    }
+
+    float* Resampler::historyChannel(uint32_t channel)
+    {
+        return &_history[channel * 2 * _history_capacity];
+    }
+
+    void Resampler::historyResize(size_t capacity)
+    {
+        capacity = std::max(capacity, _history_capacity * 2);
+
+        //held samples move to the front of the new rings
+        std::vector<float> history(_channels * 2 * capacity, 0.0f);
+        for (uint32_t channel = 0; channel < _channels && _history_capacity; channel++) {
+            const float* source = historyChannel(channel) + _history_start;
+            float* target = &history[channel * 2 * capacity];
+            std::copy(source, source + _history_fill, target);
+            std::copy(source, source + _history_fill, target + capacity);
+        }
+
+        _history = std::move(history);
+        _history_capacity = capacity;
+        _history_start = 0;
+    }
+
+    float Resampler::dot(const float* a, const float* b, size_t length)
+    {
+#if defined(MUMLIB2_RESAMPLER_SSE)
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        for (size_t i = 0; i < length; i += 8) {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, _mm_add_ps(acc0, acc1));
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(MUMLIB2_RESAMPLER_NEON)
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+        for (size_t i = 0; i < length; i += 8) {
+            acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+            acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        }
+        float32x4_t acc = vaddq_f32(acc0, acc1);
+        return vgetq_lane_f32(acc, 0) + vgetq_lane_f32(acc, 1) + vgetq_lane_f32(acc, 2) + vgetq_lane_f32(acc, 3);
+#else
+        float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (size_t i = 0; i < length; i += 4) {
+            acc[0] += a[i + 0] * b[i + 0];
+            acc[1] += a[i + 1] * b[i + 1];
+            acc[2] += a[i + 2] * b[i + 2];
+            acc[3] += a[i + 3] * b[i + 3];
+        }
+        return acc[0] + acc[1] + acc[2] + acc[3];
+#endif
+    }
+}
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//stdlib
+#include <cerrno>
+#include <cstring>
+
+//linux
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+//mumlib
+#include "mumlib2_private/thread_scheduler.h"
+
+namespace mumlib2 {
+
+    bool ThreadScheduler::Validate(const ThreadOptions& options)
+    {
+        if (options.realtime_priority < 0 || options.realtime_priority > 99) {
+            return false;
+        }
+
+        if (options.nice < -20 || options.nice > 19) {
+            return false;
+        }
+
+        return true;
+    }
+
+    void ThreadScheduler::Apply(const ThreadOptions& options, Logger& logger)
+    {
+#if defined(__linux__)
+        if (options.cpu_mask) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int cpu = 0; cpu < 64; cpu++) {
+                if (options.cpu_mask & (uint64_t(1) << cpu)) {
+                    CPU_SET(cpu, &set);
+                }
+            }
+
+            int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            if (error) {
+                logger.warn("Setting CPU affinity 0x%llx failed: %s.", static_cast<unsigned long long>(options.cpu_mask), strerror(error));
+            }
+        }
+
+        //linux keeps niceness per thread
+        if (options.nice) {
+            if (setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), options.nice)) {
+                logger.warn("Setting nice %d failed: %s.", options.nice, strerror(errno));
+            }
+        }
+
+        if (options.realtime_priority) {
+            sched_param param{};
+            param.sched_priority = options.realtime_priority;
+
+            int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+            if (error) {
+                logger.warn("Setting SCHED_FIFO priority %d failed: %s, needs CAP_SYS_NICE or RLIMIT_RTPRIO.", options.realtime_priority, strerror(error));
+            }
+        }
+
+        //page faults in the voice path are as bad as preemption
+        if (options.lock_memory) {
+            if (mlockall(MCL_CURRENT | MCL_FUTURE)) {
+                logger.warn("Locking memory failed: %s, needs CAP_IPC_LOCK or RLIMIT_MEMLOCK.", strerror(errno));
+            }
+        }
+#else
+        if (options.cpu_mask || options.nice || options.realtime_priority || options.lock_memory) {
+            logger.warn("Thread options are only supported on Linux.");
+        }
+#endif
+    }
+}
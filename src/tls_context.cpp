@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//mumlib
+#include "mumlib2/exceptions.h"
+#include "mumlib2/tls_context.h"
+#include "mumlib2_private/tls_context_private.h"
+
+namespace mumlib2 {
+
+    //
+    // TlsContextPrivate
+    //
+
+    TlsContextPrivate::TlsContextPrivate() : _context(asio::ssl::context::sslv23)
+    {
+    }
+
+    TlsContextPrivate::~TlsContextPrivate()
+    {
+        SessionClear();
+    }
+
+    asio::ssl::context& TlsContextPrivate::GetContext()
+    {
+        return _context;
+    }
+
+    SSL_SESSION* TlsContextPrivate::SessionGet(const std::string& key)
+    {
+        std::lock_guard<std::mutex> lock(_sessions_mutex);
+
+        auto it = _sessions.find(key);
+        if (it == _sessions.end()) {
+            return nullptr;
+        }
+
+        SSL_SESSION_up_ref(it->second);
+        return it->second;
+    }
+
+    void TlsContextPrivate::SessionPut(const std::string& key, SSL_SESSION* session)
+    {
+        std::lock_guard<std::mutex> lock(_sessions_mutex);
+
+        auto& entry = _sessions[key];
+        if (entry) {
+            SSL_SESSION_free(entry);
+        }
+        entry = session;
+    }
+
+    size_t TlsContextPrivate::SessionCount()
+    {
+        std::lock_guard<std::mutex> lock(_sessions_mutex);
+        return _sessions.size();
+    }
+
+    void TlsContextPrivate::SessionClear()
+    {
+        std::lock_guard<std::mutex> lock(_sessions_mutex);
+
+        for (auto& [key, session] : _sessions) {
+            SSL_SESSION_free(session);
+        }
+        _sessions.clear();
+    }
+
+    //
+    // TlsContext
+    //
+
+    TlsContext::TlsContext() : impl(std::make_unique<TlsContextPrivate>())
+    {
+    }
+
+    TlsContext::~TlsContext() = default;
+
+    std::shared_ptr<TlsContext> TlsContext::FromFiles(const std::string& cert_file, const std::string& key_file)
+    {
+        std::shared_ptr<TlsContext> result(new TlsContext());
+        auto& context = result->impl->GetContext();
+
+        try {
+            if (!cert_file.empty()) {
+                context.use_certificate_chain_file(cert_file);
+            }
+            if (!key_file.empty()) {
+                context.use_private_key_file(key_file, asio::ssl::context::file_format::pem);
+            }
+        }
+        catch (std::system_error& exp) {
+            throw TransportException(std::string("failed to load certificate: ") + exp.what());
+        }
+
+        return result;
+    }
+
+    std::shared_ptr<TlsContext> TlsContext::FromMemory(const std::string& cert_pem, const std::string& key_pem)
+    {
+        std::shared_ptr<TlsContext> result(new TlsContext());
+        auto& context = result->impl->GetContext();
+
+        try {
+            if (!cert_pem.empty()) {
+                context.use_certificate_chain(asio::buffer(cert_pem));
+            }
+            if (!key_pem.empty()) {
+                context.use_private_key(asio::buffer(key_pem), asio::ssl::context::file_format::pem);
+            }
+        }
+        catch (std::system_error& exp) {
+            throw TransportException(std::string("failed to load certificate: ") + exp.what());
+        }
+
+        return result;
+    }
+
+    size_t TlsContext::GetSessionCount() const
+    {
+        return impl->SessionCount();
+    }
+
+    void TlsContext::ClearSessions()
+    {
+        impl->SessionClear();
+    }
+}
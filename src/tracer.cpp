@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//stdlib
+#include <algorithm>
+#include <bit>
+#include <fstream>
+#include <iomanip>
+
+//mumlib
+#include "mumlib2_private/tracer.h"
+
+namespace mumlib2 {
+
+    static const char* categoryName(uint8_t category)
+    {
+        switch (static_cast<TraceCategory>(category)) {
+        case TraceCategory::TRANSPORT:
+            return "transport";
+        case TraceCategory::CRYPT:
+            return "crypt";
+        case TraceCategory::PACKET:
+            return "packet";
+        case TraceCategory::DECODER:
+            return "decoder";
+        case TraceCategory::CONTROL:
+            return "control";
+        case TraceCategory::USER_CALLBACK:
+            return "callback";
+        }
+        return "unknown";
+    }
+
+    //
+    // Ctor
+    //
+
+    Tracer::Buffer::Buffer(size_t capacity)
+    {
+        size_t size = std::bit_ceil(std::max<size_t>(capacity, 2));
+        spans = std::make_unique<Span[]>(size);
+        mask = size - 1;
+    }
+
+    Tracer& Tracer::Instance()
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    //
+    // Session
+    //
+
+    bool Tracer::Start(size_t capacity, std::chrono::microseconds slow_callback)
+    {
+        if (!capacity || slow_callback.count() < 0) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _slow_callback_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(slow_callback).count();
+        _slow_callbacks = 0;
+
+        //same size ring is reused, spans of the previous session fall below the baseline
+        size_t size = std::bit_ceil(std::max<size_t>(capacity, 2));
+        if (_buffers.empty() || _buffers.back()->mask + 1 != size) {
+            _buffers.push_back(std::make_unique<Buffer>(capacity));
+        }
+
+        Buffer* buffer = _buffers.back().get();
+        _baseline = buffer->next.load();
+        _buffer = buffer;
+        return true;
+    }
+
+    void Tracer::Stop()
+    {
+        //the ring is kept for Export()
+        _buffer = nullptr;
+    }
+
+    uint64_t Tracer::GetSlowCallbacks() const
+    {
+        return _slow_callbacks;
+    }
+
+    //
+    // Recording
+    //
+
+    uint32_t Tracer::threadId()
+    {
+        //small stable ids read better in trace viewers than native handles
+        static std::atomic<uint32_t> next = 0;
+        thread_local uint32_t id = ++next;
+        return id;
+    }
+
+    void Tracer::Record(const char* name, TraceCategory category, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+    {
+        Buffer* buffer = _buffer.load(std::memory_order_acquire);
+        if (!buffer) {
+            return;
+        }
+
+        int64_t start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start - _epoch).count();
+        int64_t duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+        bool slow = false;
+        if (category == TraceCategory::USER_CALLBACK) {
+            int64_t slow_callback_ns = _slow_callback_ns.load(std::memory_order_relaxed);
+            if (slow_callback_ns && duration_ns >= slow_callback_ns) {
+                slow = true;
+                _slow_callbacks++;
+                _logger.warn("Slow callback %s: %lld us.", name, static_cast<long long>(duration_ns / 1000));
+            }
+        }
+
+        uint64_t index = buffer->next.fetch_add(1, std::memory_order_relaxed);
+        Span& span = buffer->spans[index & buffer->mask];
+
+        span.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        span.name.store(name, std::memory_order_relaxed);
+        span.category.store(static_cast<uint8_t>(category), std::memory_order_relaxed);
+        span.slow.store(slow, std::memory_order_relaxed);
+        span.thread.store(threadId(), std::memory_order_relaxed);
+        span.start_ns.store(start_ns, std::memory_order_relaxed);
+        span.duration_ns.store(duration_ns, std::memory_order_relaxed);
+
+        span.sequence.store(index + 1, std::memory_order_release);
+    }
+
+    //
+    // Export
+    //
+
+    bool Tracer::Export(const std::string& path) const
+    {
+        struct Entry {
+            const char* name;
+            uint8_t category;
+            bool slow;
+            uint32_t thread;
+            int64_t start_ns;
+            int64_t duration_ns;
+        };
+
+        Buffer* buffer = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_buffers.empty()) {
+                return false;
+            }
+            buffer = _buffers.back().get();
+        }
+
+        uint64_t baseline = _baseline;
+        std::vector<Entry> entries;
+        entries.reserve(buffer->mask + 1);
+
+        for (size_t i = 0; i <= buffer->mask; i++) {
+            const Span& span = buffer->spans[i];
+
+            uint64_t sequence = span.sequence.load(std::memory_order_acquire);
+            Entry entry{
+                span.name.load(std::memory_order_relaxed),
+                span.category.load(std::memory_order_relaxed),
+                span.slow.load(std::memory_order_relaxed),
+                span.thread.load(std::memory_order_relaxed),
+                span.start_ns.load(std::memory_order_relaxed),
+                span.duration_ns.load(std::memory_order_relaxed)
+            };
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            //empty, being written, or left over from an earlier session
+            if (!sequence || sequence != span.sequence.load(std::memory_order_relaxed) || sequence <= baseline) {
+                continue;
+            }
+
+            entries.push_back(entry);
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.start_ns < b.start_ns;
+        });
+
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+
+        //complete events, timestamps in microseconds
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        for (size_t i = 0; i < entries.size(); i++) {
+            const Entry& entry = entries[i];
+
+            file << (i ? ",\n" : "\n")
+                << "{\"name\":\"" << entry.name
+                << "\",\"cat\":\"" << categoryName(entry.category)
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << entry.thread
+                << ",\"ts\":" << entry.start_ns / 1000.0
+                << ",\"dur\":" << entry.duration_ns / 1000.0;
+
+            if (entry.slow) {
+                file << ",\"args\":{\"slow_callback\":true}";
+            }
+            file << "}";
+        }
+        file << "\n]}\n";
+
+        return static_cast<bool>(file);
+    }
+}
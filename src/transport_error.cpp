@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+// Copyright (c) 2015-2022 mumlib2 contributors
+
+//stdlib
+#include <string>
+
+//mumlib
+#include "mumlib2/transport_error.h"
+
+namespace mumlib2 {
+
+    class TransportCategory : public std::error_category {
+    public:
+        const char* name() const noexcept override
+        {
+            return "mumlib2.transport";
+        }
+
+        std::string message(int value) const override
+        {
+            switch (static_cast<TransportError>(value)) {
+            case TransportError::CONNECT_FAILED:
+                return "failed to connect";
+            case TransportError::HANDSHAKE_FAILED:
+                return "TLS handshake failed";
+            case TransportError::TLS_RECEIVE_FAILED:
+                return "TLS receive failed";
+            case TransportError::TLS_SEND_FAILED:
+                return "TLS send failed";
+            case TransportError::MESSAGE_TOO_LARGE:
+                return "control message bigger than allowed";
+            case TransportError::REJECTED:
+                return "rejected by server";
+            case TransportError::PING_TIMEOUT:
+                return "server did not answer ping";
+            case TransportError::CRYPT_SETUP_INVALID:
+                return "invalid crypt setup";
+            case TransportError::UDP_RECEIVE_FAILED:
+                return "UDP receive failed";
+            case TransportError::UDP_SEND_FAILED:
+                return "UDP send failed";
+            case TransportError::UDP_DECRYPT_FAILED:
+                return "UDP packet decryption failed";
+            case TransportError::UDP_BEFORE_CRYPT_SETUP:
+                return "UDP packet received before crypt setup";
+            case TransportError::UDP_PACKET_TOO_LARGE:
+                return "UDP packet bigger than allowed";
+            }
+            return "unknown transport error";
+        }
+    };
+
+    const std::error_category& transport_category()
+    {
+        static TransportCategory category;
+        return category;
+    }
+
+    std::error_code make_error_code(TransportError error)
+    {
+        return { static_cast<int>(error), transport_category() };
+    }
+
+    TransportErrorPolicy transport_error_policy(TransportError error)
+    {
+        switch (error) {
+        case TransportError::UDP_DECRYPT_FAILED:
+        case TransportError::UDP_BEFORE_CRYPT_SETUP:
+        case TransportError::UDP_PACKET_TOO_LARGE:
+            return TransportErrorPolicy::DROP;
+        case TransportError::CRYPT_SETUP_INVALID:
+        case TransportError::UDP_RECEIVE_FAILED:
+        case TransportError::UDP_SEND_FAILED:
+            return TransportErrorPolicy::FALLBACK_TCP;
+        default:
+            return TransportErrorPolicy::CLOSE;
+        }
+    }
+}
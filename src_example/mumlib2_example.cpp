@@ -47,18 +47,28 @@ int main(int argc, char *argv[]) {
     std::string username = argv[3];
     std::string password = argv[4];
 
+    //certificate is read once, reconnecting instances resume the TLS session of the previous one
+    auto tlsContext = mumlib2::TlsContext::FromFiles(argc > 6 ? argv[5] : "", argc > 6 ? argv[6] : "");
+
     MyCallback myCallback;
     while (true) {
         try {
             mumlib2::Mumlib2 mum(myCallback);
             myCallback.mum = &mum;
+
+            mum.TransportSetTlsContext(tlsContext);
+
+            //server restarts are handled inside, run() only returns when reconnecting makes no sense
+            mum.TransportSetReconnect(true);
             mum.connect(server, port, username, password);
             mum.run();
 
+            logger.error("Connection closed: %s.", mum.TransportGetError().message().c_str());
         } catch (mumlib2::TransportException &exp) {
             logger.error("TransportException: %s.", exp.what());
-            logger.notice("Attempting to reconnect in 5 s.");
-            std::this_thread::sleep_for(std::chrono::seconds(5));
         }
+
+        logger.notice("Attempting to reconnect in 5 s.");
+        std::this_thread::sleep_for(std::chrono::seconds(5));
     }
 }